@@ -23,6 +23,7 @@
 #include <vars.hpp>
 
 #include <netinet/tcp.h>
+#include <linux/filter.h>
 #include <linux/in6.h>
 #include <linux/netfilter_ipv4.h>
 #include <linux/netfilter_ipv6.h>
@@ -281,10 +282,11 @@ int baseCom::poll() {
     
     _ext("baseCom::poll: called");
 
+    // poller itself won't sleep over its nearest timer (rescans, idle deadlines)
     auto wait_time = poll_msec;
-    if(not poller.rescans_empty()) {
-        _dia("baseCom::poll: rescans not empty, shorter poll cycle!");
-        wait_time = rescan_msec;
+    if(not poller.enforced_empty()) {
+        _dia("baseCom::poll: enforced sockets pending, not waiting");
+        wait_time = 0;
     }
 
     int r = poller.wait(wait_time);
@@ -337,6 +339,42 @@ int baseCom::so_reuseaddr(int sock) const {
     return sso;
 }
 
+int baseCom::so_reuseport(int sock) const {
+    constexpr int optval = 1;
+    int sso = setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof optval);
+    if(sso != 0) err_errno(string_format("baseCom::so_reuseport: setsockopt[%d]", sock).c_str(),
+                           "SOL_SOCKET/SO_REUSEPORT", sso);
+
+    return sso;
+}
+
+int baseCom::so_reuseport_cpu_steering(int sock, std::vector<int> const& slot_of_cpu) const {
+
+    // jump table: if receiving cpu == c, return its slot
+    std::vector<sock_filter> code;
+    code.push_back({ BPF_LD  | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) });
+    for(std::size_t c = 0; c < slot_of_cpu.size(); ++c) {
+        if(slot_of_cpu[c] < 0) continue;
+
+        code.push_back({ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, static_cast<uint32_t>(c) });
+        code.push_back({ BPF_RET | BPF_K, 0, 0, static_cast<uint32_t>(slot_of_cpu[c]) });
+    }
+    // index out of the group: kernel selects by hash
+    code.push_back({ BPF_RET | BPF_K, 0, 0, 0xffffffff });
+
+    if(code.size() > BPF_MAXINSNS) {
+        _err("baseCom::so_reuseport_cpu_steering: %d cpus is too many for the program", slot_of_cpu.size());
+        return -1;
+    }
+    sock_fprog prog { static_cast<unsigned short>(code.size()), code.data() };
+
+    int sso = setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+    if(sso != 0) err_errno(string_format("baseCom::so_reuseport_cpu_steering: setsockopt[%d]", sock).c_str(),
+                           "SOL_SOCKET/SO_ATTACH_REUSEPORT_CBPF", sso);
+
+    return sso;
+}
+
 int baseCom::so_broadcast(int sock) const {
     constexpr int optval = 1;
     int sso = setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &optval, sizeof optval);
@@ -20,6 +20,7 @@
 #define BASECOM_HPP
 
 #include <string>
+#include <vector>
 #include <cstring>
 #include <ctime>
 #include <csignal>
@@ -27,6 +28,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/stat.h>
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -103,6 +105,7 @@ protected:
     // non-local socket support
     bool nonlocal_dst_ = false;
     bool nonlocal_dst_resolved_ = false;
+    bool reuseport_ = false;
     std::string nonlocal_dst_host_;
     unsigned short nonlocal_dst_port_ = 0;
     struct sockaddr_storage nonlocal_dst_peer_info_{};
@@ -168,9 +171,36 @@ public:
     
     virtual int connect(const char* , const char*) = 0;
     virtual int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen_) = 0;
+
+    // accept up to 'max' pending connections, store them to 'out'. @return number of accepted sockets.
+    // Default accepts single one with accept().
+    virtual std::size_t accept_batch(int sockfd, int* out, std::size_t max) {
+        if(max == 0) return 0;
+
+        sockaddr_storage ss {};
+        socklen_t len = sizeof(ss);
+        auto s = accept(sockfd, reinterpret_cast<sockaddr*>(&ss), &len);
+        if(s < 0) return 0;
+
+        out[0] = s;
+        return 1;
+    }
     virtual ssize_t read(int _fd, void* _buf, size_t _n, int _flags) = 0;
     virtual ssize_t peek(int _fd, void* _buf, size_t _n, int _flags) = 0;
     virtual ssize_t write(int _fd, const void* _buf, size_t _n, int _flags) = 0;
+
+    // gather write. Default writes buffers one by one with write(), stopping on short write.
+    virtual ssize_t writev(int _fd, iovec const* _iov, int _iovcnt, int _flags) {
+        ssize_t total = 0;
+        for(int i = 0; i < _iovcnt; ++i) {
+            auto r = write(_fd, _iov[i].iov_base, _iov[i].iov_len, _flags);
+            if(r < 0) return total > 0 ? total : r;
+
+            total += r;
+            if(static_cast<size_t>(r) < _iov[i].iov_len) break;
+        }
+        return total;
+    }
     virtual void shutdown(int _fd) = 0;
     virtual void close(int _fd);
     virtual int bind(unsigned short _port) = 0;
@@ -184,6 +214,10 @@ public:
 
     /// @brief so_<> functions set some well-known socket feature, typically using **setsockopt**
     int so_reuseaddr(int sock) const;
+    int so_reuseport(int sock) const;
+    // attach classic BPF selecting socket of reuseport group by receiving CPU: index is slot_of_cpu[cpu]. CPUs with
+    // negative slot, or not in the table, are left to the default hash.
+    int so_reuseport_cpu_steering(int sock, std::vector<int> const& slot_of_cpu) const;
     int so_broadcast(int sock) const;
     int so_nodelay(int sock) const;
     int so_quickack(int sock) const;
@@ -254,6 +288,9 @@ public:
     virtual bool in_writeset(int s) { return master()->poller.in_write_set(s); };
     virtual bool in_idleset(int s) { return master()->poller.in_idle_set(s); };
 
+    // edge-triggered poller: I/O must drain the socket until EAGAIN
+    inline bool edge_triggered() { return master()->poller.edge_triggered(); }
+
     inline void set_monitor(int xs) {
         _deb("basecom::set_monitor: called to add %d", xs);
 
@@ -394,6 +431,14 @@ public:
             master()->poller.clear_idle_watch(s);
         }
     }
+    // virtual sockets are not translated, their deadlines are reported separately
+    inline void set_idle_deadline(int s, long timeout_ms) {
+        _deb("basecom::set_idle_deadline: called: %d, %dms", s, timeout_ms);
+
+        if(s != 0) {
+            master()->poller.set_idle_deadline(s, timeout_ms);
+        }
+    }
 
 
     inline void rescan_read(int xs) {
@@ -449,6 +494,10 @@ public:
 
     [[nodiscard]] inline bool nonlocal_src() const { return nonlocal_src_; }
     inline void nonlocal_src(bool b) { nonlocal_src_ = b; } 
+
+    // bind() sockets with SO_REUSEPORT, so more of them can listen on the same port
+    [[nodiscard]] inline bool reuseport() const { return reuseport_; }
+    inline void reuseport(bool b) { reuseport_ = b; }
     inline std::string& nonlocal_src_host() { return nonlocal_src_host_; }
     inline unsigned short& nonlocal_src_port() { return nonlocal_src_port_; }
     
@@ -16,9 +16,11 @@
     License along with this library.
 */
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 
 #include <cstring>
@@ -57,6 +59,7 @@ void baseProxy::ladd(baseHostCX* cs) {
     com()->set_poll_handler(s,this);
     left_sockets.push_back(cs);
     cs->parent_proxy(this, 'L');
+    cs->arm_deadline();
     _dia("baseProxy::ladd: added socket: %s", cs->c_type());
 }
 
@@ -70,6 +73,7 @@ void baseProxy::radd(baseHostCX* cs) {
     com()->set_poll_handler(s,this);
     right_sockets.push_back(cs);
     cs->parent_proxy(this, 'R');
+    cs->arm_deadline();
     _dia("baseProxy::radd: added socket: %s", cs->c_type());
 }
 
@@ -106,6 +110,7 @@ void baseProxy::lpcadd(baseHostCX* cx) {
     com()->set_poll_handler(s,this);
     left_pc_cx.push_back(cx);
     cx->parent_proxy(this, 'L');
+    cx->arm_deadline();
     _dia("baseProxy::lpcadd: added perma socket: %s", cx->c_type());
 }
 
@@ -119,6 +124,7 @@ void baseProxy::rpcadd(baseHostCX* cx) {
     
     right_pc_cx.push_back(cx);
     cx->parent_proxy(this,'R');
+    cx->arm_deadline();
     _dia("baseProxy::rpcadd: added perma socket %s", cx->c_type());
 }
 
@@ -132,6 +138,7 @@ void baseProxy::ldaadd(baseHostCX* cs) {
 
     left_delayed_accepts.push_back(cs);
     cs->parent_proxy(this,'l');
+    cs->arm_deadline();
     _dia("baseProxy::ldaadd: added delayed socket: %s", cs->c_type());
 }
 
@@ -145,6 +152,7 @@ void baseProxy::rdaadd(baseHostCX* cs) {
     
     right_delayed_accepts.push_back(cs);
     cs->parent_proxy(this,'r');
+    cs->arm_deadline();
     _dia("baseProxy::rdaadd: added delayed socket: %s", cs->c_type());
 }
 
@@ -215,6 +223,7 @@ void baseProxy::shutdown() {
     _dia("baseProxy::shutdown");
 	left_shutdown();
 	right_shutdown();
+    splice_release();
     _deb("baseProxy::shutdown finished");
 }
 
@@ -258,36 +267,109 @@ bool baseProxy::run_timers () {
 
     if(clicker_.reset_timer()) {
 
-        auto cx_check = [&](auto* cx, bool idle_check=false) {
-            on_cx_timer(cx);
-            if(idle_check && cx->idle_timeout()) {
+        // idle and opening timeouts are not scanned, poller reports cx with due deadline (see on_cx_deadline())
+        auto for_each_timer = [&](auto const& what) {
+            for(auto* cx: what) {
+                on_cx_timer(cx);
+            }
+        };
+
+        for_each_timer(left_sockets);
+        for_each_timer(left_delayed_accepts);
+        for_each_timer(left_bind_sockets);
+        for_each_timer(left_pc_cx);
+
+        for_each_timer(right_sockets);
+        for_each_timer(right_delayed_accepts);
+        for_each_timer(right_bind_sockets);
+        for_each_timer(right_pc_cx);
+
+        return true;
+    }
+
+    return false;
+}
+
+void baseProxy::on_cx_deadline(int socket) {
+
+    auto check = [&](auto const& vec, unsigned char side) {
+        for(auto* cx: vec) {
+            if(cx->socket() != socket) continue;
+
+            if(cx->opening_timeout()) {
+                handle_cx_events(side, cx);
+            }
+            else if(cx->idle_timeout()) {
                 state().dead(true);
 
                 _dia("%s: timed out!", hr().c_str());
             }
-        };
+            else {
+                cx->arm_deadline();
+            }
+            return true;
+        }
+        return false;
+    };
+
+    check(left_sockets, 'l') or check(left_delayed_accepts, 'l') or check(left_pc_cx, 'x')
+        or check(right_sockets, 'r') or check(right_delayed_accepts, 'r') or check(right_pc_cx, 'y');
+}
 
-        auto for_each_check = [&](auto what, bool idle_check=false) {
-            for(auto it: what) {
-                cx_check(it, idle_check);
+bool baseProxy::migratable() {
+
+    if(state().dead() or state().in_progress()) return false;
+    if(not left_bind_sockets.empty() or not right_bind_sockets.empty()) return false;
+
+    auto* my_master = com()->master();
+    auto all_real = [my_master](auto const& vec) {
+        return std::all_of(vec.begin(), vec.end(), [my_master](auto* cx) {
+            return cx->socket() > 0 and cx->com()->master() == my_master;
+        });
+    };
+
+    return all_real(left_sockets) and all_real(right_sockets) and all_real(left_pc_cx) and all_real(right_pc_cx)
+        and all_real(left_delayed_accepts) and all_real(right_delayed_accepts);
+}
+
+void baseProxy::detach_poller() {
+    _dia("baseProxy::detach_poller: releasing sockets");
+    com()->master()->poller.release_handler(this);
+}
+
+void baseProxy::attach_poller(baseCom* new_master) {
+
+    com()->master(new_master);
+
+    auto attach = [&](auto const& vec, bool idle_check) {
+        for(auto* cx: vec) {
+            cx->com()->master(new_master);
+
+            int s = cx->socket();
+            com()->set_monitor(s);
+            if(cx->write_pending() > 0) {
+                com()->set_write_monitor(s);
             }
-        };
+            com()->set_poll_handler(s, this);
 
+            // readiness could have been reported to the old poller already
+            com()->set_enforce(s);
 
-        for_each_check(left_sockets, true);
-        for_each_check(left_delayed_accepts, true);
-        for_each_check(left_bind_sockets);
-        for_each_check(left_pc_cx, true);
+            if(idle_check) {
+                cx->arm_deadline();
+            }
+        }
+    };
 
-        for_each_check(right_sockets, true);
-        for_each_check(right_delayed_accepts, true);
-        for_each_check(right_bind_sockets);
-        for_each_check(right_pc_cx, true);
+    attach(left_sockets, true);
+    attach(left_delayed_accepts, true);
+    attach(left_pc_cx, true);
 
-        return true;
-    }
+    attach(right_sockets, true);
+    attach(right_delayed_accepts, true);
+    attach(right_pc_cx, true);
 
-    return false;
+    _dia("baseProxy::attach_poller: attached to new master com");
 }
 
 // (re)set socket set and calculate max socket no
@@ -365,7 +447,11 @@ bool baseProxy::handle_cx_read(unsigned char side, baseHostCX* cx) {
     
     if (proceed) {
         _ext("%c in R fdset and readable: %d", side, cx->socket());
-        int red = cx->read();
+
+        auto* splice_to = splice_peer(side, cx);
+        if(splice_to and not splice_prepare(side)) splice_to = nullptr;
+
+        int red = splice_to ? handle_cx_splice(side, cx, splice_to) : cx->read();
         
         if (red == 0) {
             cx->shutdown();
@@ -391,7 +477,11 @@ bool baseProxy::handle_cx_read(unsigned char side, baseHostCX* cx) {
             return false;
         }
         
-        if (red > 0) {
+        if (red > 0 and splice_to) {
+            stats_.last_read += red;
+            _deb("baseProxy::handle_cx_read[%c]: %d bytes spliced", side, red);
+        }
+        else if (red > 0) {
             stats_.last_read += red;
             if     (side == 'l') { on_left_bytes(cx); }
             else if(side == 'r') { on_right_bytes(cx); }
@@ -417,7 +507,29 @@ bool baseProxy::handle_cx_write(unsigned char side, baseHostCX* cx) {
     
     if (proceed) {
         _ext("baseProxy::handle_cx_write[%c]: writable: %d", side, cx->socket());
-        int wrt = cx->write();
+
+        // deliver spliced data waiting in pipe first, then resume reading the source
+        int wrt = 0;
+        auto& leg = splice_legs_[1 - splice_leg_index(side)];
+        if(leg.pending > 0) {
+            if(splice_flush(leg, side, cx)) {
+                if(leg.source >= 0) {
+                    // source was taken out of polling while the pipe was full
+                    com()->master()->poller.cancel_rescan_in(leg.source);
+                    com()->set_monitor(leg.source);
+                    com()->set_enforce(leg.source);
+                }
+            }
+            else if(cx->error()) {
+                wrt = -1;
+            }
+            else {
+                // still full, wait for next EPOLLOUT
+                return true;
+            }
+        }
+
+        if(wrt == 0) wrt = cx->write();
         if (wrt < 0) {
             cx->shutdown();
             //left_sockets.erase(i);
@@ -457,6 +569,135 @@ bool baseProxy::handle_cx_write(unsigned char side, baseHostCX* cx) {
     return true;
 }
 
+// move data from 'from' to 'to' through the pipe of this direction. Returns like read(): bytes moved in, 0 on EOF
+// or error, -1 if nothing was done (would block, or previous data not delivered yet).
+int baseProxy::handle_cx_splice(unsigned char side, baseHostCX* from, baseHostCX* to) {
+
+    auto& leg = splice_legs_[splice_leg_index(side)];
+    unsigned char to_side = (side == 'l' or side == 'x') ? 'r' : 'l';
+
+    leg.source = from->socket();
+
+    // peer didn't accept previous data, its EPOLLOUT will resume us. Source stays readable meanwhile, take it
+    // out of polling like read() does, otherwise we spin.
+    if(not splice_flush(leg, to_side, to)) {
+        if(to->error()) return 0;
+
+        com()->rescan_read(from->socket());
+        return -1;
+    }
+
+    std::size_t moved = 0;
+    while(moved < splice_budget) {
+        auto n = ::splice(from->socket(), nullptr, leg.pipe.w, nullptr, splice_budget - moved,
+                          SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if(n < 0 and errno == EINTR) continue;
+
+        if(n < 0 and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+            break;
+        }
+        if(n <= 0) {
+            if(n < 0) {
+                _dia("baseProxy::handle_cx_splice[%c]: socket %d: %s", side, from->socket(), string_error().c_str());
+                from->error(true);
+            }
+            if(moved > 0) from->after_spliced_read(moved);
+
+            // try to deliver the rest, there is no other chance
+            splice_flush(leg, to_side, to);
+            return 0;
+        }
+
+        moved += static_cast<std::size_t>(n);
+        leg.pending += static_cast<std::size_t>(n);
+
+        if(not splice_flush(leg, to_side, to)) break;
+    }
+
+    if(leg.pending > 0) {
+        com()->rescan_read(from->socket());
+    }
+
+    // budget exhausted: data may still be in socket, which is not signalled again in edge-triggered mode
+    if(moved >= splice_budget and leg.pending == 0) {
+        com()->set_enforce(from->socket());
+    }
+
+    if(moved == 0) return -1;
+
+    from->after_spliced_read(moved);
+    return static_cast<int>(moved);
+}
+
+// make sure the direction has its pipe, otherwise data must go through buffers
+bool baseProxy::splice_prepare(unsigned char side) {
+    auto& leg = splice_legs_[splice_leg_index(side)];
+
+    if(not leg.pipe.valid()) {
+        leg.pipe = pipe_pool::acquire();
+        if(not leg.pipe.valid()) {
+            _err("baseProxy::splice_prepare[%c]: cannot create pipe: %s", side, string_error().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// write pipe content to 'to'. Returns true if pipe is empty.
+bool baseProxy::splice_flush(splice_leg& leg, unsigned char to_side, baseHostCX* to) {
+
+    std::size_t written = 0;
+    bool ret = true;
+
+    while(leg.pending > 0) {
+        auto n = ::splice(leg.pipe.r, nullptr, to->socket(), nullptr, leg.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if(n > 0) {
+            leg.pending -= static_cast<std::size_t>(n);
+            written += static_cast<std::size_t>(n);
+            continue;
+        }
+        if(n < 0 and errno == EINTR) continue;
+
+        if(n < 0 and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+            _deb("baseProxy::splice_flush[%c]: socket %d full, %d bytes pending", to_side, to->socket(), leg.pending);
+            com()->set_write_monitor(to->socket());
+        }
+        else {
+            _dia("baseProxy::splice_flush[%c]: socket %d: %s", to_side, to->socket(), string_error().c_str());
+            to->error(true);
+        }
+        ret = false;
+        break;
+    }
+
+    if(written > 0) {
+        to->after_spliced_write(written);
+        stats_.last_write += written;
+
+        if (stats_.do_rate_meter) {
+            if (to_side == 'l' or to_side == 'x') {
+                stats_.mtr_down.update(written);
+            } else {
+                stats_.mtr_up.update(written);
+            }
+        }
+    }
+
+    return ret;
+}
+
+void baseProxy::splice_release() {
+    for(auto& leg: splice_legs_) {
+        if(not leg.pipe.valid()) continue;
+
+        // undelivered data belong to this proxy only
+        if(leg.pending > 0) pipe_pool::close(leg.pipe);
+        else pipe_pool::release(leg.pipe);
+
+        leg = splice_leg();
+    }
+}
+
 bool baseProxy::handle_cx_read_once(unsigned char side, baseCom* xcom, baseHostCX* cx) {
 
     bool ret = true;
@@ -510,8 +751,14 @@ bool baseProxy::handle_cx_read_once(unsigned char side, baseCom* xcom, baseHostC
             }
         }
     } else {
+        bool in_read_set = xcom->in_readset(cx->socket());
         _dia("baseProxy::handle_cx_read_once[%c]: waiting_for_peercom read in cx with socket %d, in read_set: %s", side, cx->socket(),
-                                                                 xcom->in_readset(cx->socket()) ? "yes" : "no");
+                                                                 in_read_set ? "yes" : "no");
+
+        // edge-triggered: we are leaving data in the socket, there will be no new edge for them
+        if(in_read_set and cx->com()->edge_triggered()) {
+            cx->com()->rescan_read(cx->socket());
+        }
     }
 
     // on failure, skip all operations and go here
@@ -619,19 +866,19 @@ bool baseProxy::handle_cx_write_once(unsigned char side, baseCom* xcom, baseHost
     bool in_force_writeset = cx->com()->forced_write_reset();
 
 
-    if( in_writeset || in_force_writeset || ( ! cx->writebuf()->empty() ) ) {
+    if( in_writeset || in_force_writeset || ( cx->write_pending() > 0 ) ) {
 
         bool side_left = side == 'l' || side == 'L' || side == 'x' || side == 'X';
         bool side_right = side == 'r' || side == 'R' || side == 'y' || side == 'Y';
 
-        auto  orig_bytes_sz = cx->writebuf()->size();
+        auto  orig_bytes_sz = cx->write_pending();
         auto  pending_bytes_sz = orig_bytes_sz;
 
         if(! handle_cx_write(side, cx)) {
             handle_cx_events(side,cx);
             return false;
         }
-        pending_bytes_sz = cx->writebuf()->size();
+        pending_bytes_sz = cx->write_pending();
         auto written_sz = orig_bytes_sz - pending_bytes_sz;
 
         if(cx->com()->forced_read_on_write()) {
@@ -704,21 +951,56 @@ bool baseProxy::handle_sockets_accept(unsigned char side, baseCom* xcom, baseHos
         else if(side == 'r') { on_right_new_raw(client); }
     }
     else {
-        auto* cx = new_cx(client);
+        handle_accepted(side, client);
+    }
+    
+    return true;
+}
 
-        if(!cx->read_waiting_for_peercom()) {
-            _dia("baseProxy::handle_sockets_accept[%c]: new unpaused socket %d -> accepting", side, client);
-            cx->on_accept_socket(client);
+void baseProxy::handle_accepted(unsigned char side, int client) {
 
-        } else {
-            _dia("baseProxy::handle_sockets_accept[%c]: new waiting_for_peercom socket %d -> delaying", side, client);
-            cx->on_delay_socket(client);
-        }
-        
-        if     (side == 'l') { on_left_new(cx); }
-        else if(side == 'r') { on_right_new(cx); }
+    auto* cx = new_cx(client);
+
+    if(!cx->read_waiting_for_peercom()) {
+        _dia("baseProxy::handle_sockets_accept[%c]: new unpaused socket %d -> accepting", side, client);
+        cx->on_accept_socket(client);
+
+    } else {
+        _dia("baseProxy::handle_sockets_accept[%c]: new waiting_for_peercom socket %d -> delaying", side, client);
+        cx->on_delay_socket(client);
     }
-    
+
+    if     (side == 'l') { on_left_new(cx); }
+    else if(side == 'r') { on_right_new(cx); }
+}
+
+
+bool baseProxy::handle_sockets_accept_drain(unsigned char side, baseCom* xcom, baseHostCX* thiscx) {
+
+    static thread_local std::vector<int> batch;
+    batch.resize(std::max(accept_drain_budget, 1U));
+
+    auto accepted = com()->accept_batch(thiscx->socket(), batch.data(), batch.size());
+    if(accepted == 0) {
+        _dia("baseProxy::handle_sockets_accept_drain[%c]: nothing accepted", side);
+        return false;
+    }
+
+    if(new_raw()) {
+        _deb("baseProxy::handle_sockets_accept_drain[%c]: raw processing of %d sockets", side, accepted);
+        if     (side == 'l') { on_left_new_raw_batch(batch.data(), accepted); }
+        else if(side == 'r') { on_right_new_raw_batch(batch.data(), accepted); }
+    }
+    else {
+        for(std::size_t i = 0; i < accepted; ++i) handle_accepted(side, batch[i]);
+    }
+
+    // edge-triggered: backlog will not be reported again
+    if(accepted >= batch.size() and com()->edge_triggered()) {
+        _dia("baseProxy::handle_sockets_accept_drain[%c]: budget of %d reached, enforcing next round", side, accepted);
+        com()->set_enforce(thiscx->socket());
+    }
+
     return true;
 }
 
@@ -915,7 +1197,7 @@ int baseProxy::handle_sockets_once(baseCom* xcom) {
 
                         if(m) {
                             auto l_ = std::unique_lock(*m);
-                            handle_sockets_accept('l', xcom, (i));
+                            handle_sockets_accept_drain('l', xcom, (i));
                         }
                         else {
                             handle_sockets_accept('l', xcom, (i));
@@ -942,7 +1224,7 @@ int baseProxy::handle_sockets_once(baseCom* xcom) {
 
                         if(m) {
                             auto l_ = std::unique_lock(*m);
-                            handle_sockets_accept('r', xcom, (i));
+                            handle_sockets_accept_drain('r', xcom, (i));
                         }
                         else {
                             handle_sockets_accept('r', xcom, (i));
@@ -1058,7 +1340,7 @@ void baseProxy::on_right_new(baseHostCX* cx) {
 	radd(cx);
 }
 
-auto baseProxy::run_poll_socket_null_handler(int cur_socket, epoll::set_type& real_set, socket_set_type set_type) -> metering::poll {
+auto baseProxy::run_poll_socket_null_handler(int cur_socket, socket_set_type set_type) -> metering::poll {
     int hint_socket = poller()->hint_socket();
 
     _if_deb {
@@ -1101,7 +1383,7 @@ auto baseProxy::run_poll_socket_null_handler(int cur_socket, epoll::set_type& re
     }
 }
 
-auto baseProxy::run_poll_socket(int cur_socket, epoll::set_type& real_set, socket_set_type set_type) -> metering::poll {
+auto baseProxy::run_poll_socket(int cur_socket, socket_set_type set_type) -> metering::poll {
 
     metering::poll ret;
 
@@ -1126,6 +1408,10 @@ auto baseProxy::run_poll_socket(int cur_socket, epoll::set_type& real_set, socke
 
                 auto lcx = logan_context(proxy->to_string(iNOT));
 
+                if(set_type == socket_set_type::IDLESET) {
+                    proxy->on_cx_deadline(cur_socket);
+                }
+
                 _deb("baseProxy::run_poll: socket %d -> handler 0x%x : executing", cur_socket, proxy);
                 // call poller-carried proxy handler!
                 proxy->handle_sockets_once(com());
@@ -1151,12 +1437,10 @@ auto baseProxy::run_poll_socket(int cur_socket, epoll::set_type& real_set, socke
         }
 
     } else {
-        auto nh = run_poll_socket_null_handler(cur_socket, real_set, set_type);
+        auto nh = run_poll_socket_null_handler(cur_socket, set_type);
         ret += nh;
     }
 
-    // locked, erase currently handled socket from the set
-    real_set.erase(cur_socket);
     return ret;
 }
 
@@ -1170,44 +1454,66 @@ int baseProxy::run_poll() {
 
     metering::poll stats;
 
-    std::array<epoll::set_type*,5> sets;
+    std::array<epoll::set_type*,4> sets;
     sets[socket_set_type::INSET] = &poller()->in_set;
     sets[socket_set_type::OUTSET] = &poller()->out_set;
     sets[socket_set_type::IDLESET] = &poller()->idle_set;
     sets[socket_set_type::ERRSET] = &poller()->err_set;
-    sets[socket_set_type::VIRTSET] = nullptr;
 
     static constexpr std::array<const char*,5> setname = { "inset", "outset", "idleset", "errset", "virt-inset" };
     int name_iter = socket_set_type::INSET;
 
+    for (epoll::set_type* current_set: sets) {
+
+        // handlers may modify the set, iterate over the copy (vector capacity is reused)
+        current_set->snapshot(poll_snapshot_);
+
+        for (auto cur_socket: poll_snapshot_) {
+            _deb("baseProxy::run: %s socket %d ", setname.at(name_iter), cur_socket);
+            auto round_stats = run_poll_socket(cur_socket, (socket_set_type) name_iter);
+
+            // locked, erase currently handled socket from the set
+            current_set->erase(cur_socket);
+            stats += round_stats;
+        }
+
+        name_iter++;
+    }
+
     bool is_udp = com()->master()->l4_proto() == SOCK_DGRAM;
     if(is_udp) {
+
+        auto udpc = UDPCom::datagram_com_static();
+        auto& virt_set = udpc->in_virt_set;
         {
-            auto udpc = UDPCom::datagram_com_static();
-            auto lc_ = std::scoped_lock(udpc->lock, udpc->in_virt_set.get_lock());
+            auto lc_ = std::scoped_lock(udpc->lock, virt_set.get_lock());
+            poll_snapshot_.assign(virt_set.get_ul().begin(), virt_set.get_ul().end());
+        }
 
-            sets[socket_set_type::VIRTSET] = &udpc->in_virt_set;
+        for (auto cur_socket: poll_snapshot_) {
+            _deb("baseProxy::run: %s socket %d ", setname.at(socket_set_type::VIRTSET), cur_socket);
+            auto round_stats = run_poll_socket(cur_socket, socket_set_type::VIRTSET);
+
+            virt_set.erase(cur_socket);
+            stats += round_stats;
         }
     }
 
-    for (epoll::set_type* current_set: sets) {
-        if(not current_set) continue;
-
-        mp::set<int> copied;
+    // virtual sockets with expired idle deadline
+    auto& idle_virt_set = poller()->idle_virt_set;
+    if(not idle_virt_set.empty()) {
         {
-            auto l_ = std::scoped_lock(current_set->get_lock());
-            for(auto s: current_set->get_ul()) {
-                copied.emplace(s);
-            }
+            auto lc_ = std::scoped_lock(idle_virt_set.get_lock());
+            poll_snapshot_.assign(idle_virt_set.get_ul().begin(), idle_virt_set.get_ul().end());
         }
-        for (auto cur_socket: copied) {
-            _deb("baseProxy::run: %s socket %d ", setname.at(name_iter), cur_socket);
-            auto round_stats = run_poll_socket(cur_socket, *current_set, (socket_set_type) name_iter);
 
+        for (auto cur_socket: poll_snapshot_) {
+            _deb("baseProxy::run: %s socket %d ", setname.at(socket_set_type::IDLESET), cur_socket);
+            auto round_stats = run_poll_socket(cur_socket, socket_set_type::IDLESET);
+
+            idle_virt_set.erase(cur_socket);
             stats += round_stats;
         }
-
-        name_iter++;
     }
 
     // clear in_set, so already handled sockets are excluded
@@ -23,12 +23,14 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <array>
 #include <ctime>
 
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include <log/logger.hpp>
+#include <pipepool.hpp>
 #include <hostcx.hpp>
 #include <mpstd.hpp>
 #include <sobject.hpp>
@@ -203,6 +205,9 @@ protected:
         
     bool pollroot_ = false;    
 
+    // sockets of currently processed poll set, reused across run_poll() calls to avoid allocations
+    std::vector<int> poll_snapshot_;
+
 public:
     metering const& stats() const { return stats_; }
     proxy_state& state() { return status_; }
@@ -291,8 +296,8 @@ public:
 
 
 
-    metering::poll run_poll_socket(int cur_socket, epoll::set_type &real_set, socket_set_type set_type);          // do actual work with the socket
-    metering::poll run_poll_socket_null_handler(int cur_socket, epoll::set_type& real_set, socket_set_type set_type);          // treat specifically sockets without hnadlers set (maybe legit, ie. hint sockets)
+    metering::poll run_poll_socket(int cur_socket, socket_set_type set_type);          // do actual work with the socket
+    metering::poll run_poll_socket_null_handler(int cur_socket, socket_set_type set_type);          // treat specifically sockets without hnadlers set (maybe legit, ie. hint sockets)
 
     int prepare_sockets(baseCom*) override;   // which Com should be set: typically it should be the parent's proxy's Com
     
@@ -307,6 +312,11 @@ public:
 
     //bound sockets
     bool handle_sockets_accept(unsigned char side, baseCom* xcom, baseHostCX* thiscx);
+    // accept a batch of connections (at most accept_drain_budget) with baseCom::accept_batch(), raw sockets are
+    // passed in one on_*_new_raw_batch() call
+    bool handle_sockets_accept_drain(unsigned char side, baseCom* xcom, baseHostCX* thiscx);
+    void handle_accepted(unsigned char side, int client);
+    static inline unsigned int accept_drain_budget = 64;
     
     int handle_sockets_once(baseCom*) override;
     void handle_event(baseCom* com) override {
@@ -340,9 +350,22 @@ public:
     // empty virtual to allow the logic without need to implement it via abstract mechanisms
     virtual void on_left_new_raw(int sock) {};
     virtual void on_right_new_raw(int sock) {};
+    virtual void on_left_new_raw_batch(int const* socks, std::size_t count) {
+        for(std::size_t i = 0; i < count; ++i) on_left_new_raw(socks[i]);
+    };
+    virtual void on_right_new_raw_batch(int const* socks, std::size_t count) {
+        for(std::size_t i = 0; i < count; ++i) on_right_new_raw(socks[i]);
+    };
         
     virtual bool run_timers ();
 
+    // moving proxy to another event loop (work stealing). Proxy can be moved only between rounds, with all its
+    // sockets real (no virtual or bound ones). detach_poller() releases sockets from current master poller,
+    // attach_poller() re-targets all coms to 'new_master' and registers sockets there.
+    [[nodiscard]] bool migratable();
+    void detach_poller();
+    void attach_poller(baseCom* new_master);
+
 
     unsigned int change_monitor_for_cx_vec(std::vector<baseHostCX*>* cx_vec, bool ifread, bool ifwrite,int pause_read, int pause_write);
     unsigned int change_side_monitoring(unsigned char side, bool ifread, bool ifwrite, int pause_read, int pause_write);
@@ -365,12 +388,34 @@ protected:
 
     bool on_cx_timer(baseHostCX*);
 
+    // poller reported due deadline of cx with 'socket': opening or idle timeout, or re-arm
+    void on_cx_deadline(int socket);
+
+    // zero-copy forwarding: return cx where data arriving on 'cx' should be spliced to, or nullptr to read them
+    // into readbuf as usual. Spliced bytes are metered, but on_*_bytes() is not called for them.
+    virtual baseHostCX* splice_peer(unsigned char side, baseHostCX* cx) { return nullptr; }
+    static inline std::size_t splice_budget = 1024 * 1024;     // max bytes moved in one read event
+
 public:
     // implement advanced logging
     TYPENAME_BASE("baseProxy")
     DECLARE_LOGGING(to_string)
 
 private:
+    // pipe between sockets, one per direction: [0] left->right, [1] right->left
+    struct splice_leg {
+        pipe_pool::pipe_pair pipe;
+        std::size_t pending = 0;   // bytes in pipe not yet written to peer
+        int source = -1;           // socket to resume reading from once pipe is flushed
+    };
+    std::array<splice_leg, 2> splice_legs_;
+    static unsigned int splice_leg_index(unsigned char from_side) { return (from_side == 'l' or from_side == 'x') ? 0 : 1; }
+
+    bool splice_prepare(unsigned char side);
+    int handle_cx_splice(unsigned char side, baseHostCX* from, baseHostCX* to);
+    bool splice_flush(splice_leg& leg, unsigned char to_side, baseHostCX* to);
+    void splice_release();
+
     logan_lite log {"proxy"};
 };
 
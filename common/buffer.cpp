@@ -1,11 +1,6 @@
 #include <buffer.hpp>
 
 
-#ifdef SOCLE_MEM_PROFILE  
-std::unordered_map<std::string,int> buffer::alloc_map;
-std::mutex buffer::alloc_map_lock_;
-#endif
-
 #include <string>
 #include <regex>
 #include <iterator>
@@ -28,14 +23,14 @@ std::mutex buffer::alloc_map_lock_;
 
 
 void buffer::dealloc() noexcept {
-    if (free_ && capacity_ > 0) {
+    if (free_ && capacity_ + head_ > 0) {
 
         if(use_pool) {
-            memPool::pool().release({data_, capacity_});
+            memPool::pool().release({data_ - head_, capacity_ + head_});
         }
         else {
-            delete[] data_;
-            counter_free(capacity_);
+            delete[] (data_ - head_);
+            counter_free(capacity_ + head_);
         }
     }
 }
@@ -46,6 +41,7 @@ void buffer::release() noexcept {
 
     capacity_ = 0L;
     size_ = 0L;
+    head_ = 0L;
     data_ = nullptr;
     free_ = false;
 }
@@ -193,6 +189,7 @@ buffer& buffer::operator=(const buffer& x)
     if (x.size_ > capacity_ or not data_)
     {
         dealloc();
+        head_ = 0;
 
         capacity_ = x.capacity_;
 
@@ -227,21 +224,26 @@ void buffer::swap (buffer& x) noexcept
     unsigned char* d (x.data_);
     size_type s (x.size_);
     size_type c (x.capacity_);
+    size_type h (x.head_);
     bool f (x.free_);
 
     x.data_ = data_;
     x.size_ = size_;
     x.capacity_ = capacity_;
+    x.head_ = head_;
     x.free_ = free_;
 
     data_ = d;
     size_ = s;
     capacity_ = c;
+    head_ = h;
     free_ = f;
 }
 
 unsigned char* buffer::detach()
 {
+    // caller takes the allocation, it must start at data()
+    compact();
     unsigned char* r (data_);
 
     data_ = nullptr;
@@ -260,6 +262,7 @@ void buffer::assign (const void* d, size_type s)
     if (s > capacity_)
     {
         dealloc();
+        head_ = 0;
 
         if(use_pool) {
             mem_chunk_t mch = memPool::pool().acquire(s);
@@ -289,6 +292,7 @@ void buffer::assign (void* d, size_type s, size_type c, bool own)
     data_ = static_cast<unsigned char*> (d);
     size_ = s;
     capacity_ = c;
+    head_ = 0;
     free_ = own;
 
     if(own && !use_pool)
@@ -361,6 +365,12 @@ bool buffer::capacity (size_type c)
     if (capacity_ >= c)
         return false;
 
+    // consumed space in front is enough, no need to reallocate
+    if (head_ > 0 and capacity_ + head_ >= c) {
+        compact();
+        return true;
+    }
+
     unsigned char* d = nullptr;
     size_type cd = 0;
 
@@ -386,6 +396,7 @@ bool buffer::capacity (size_type c)
     dealloc();
 
     data_ = d;
+    head_ = 0;
 
     // pool can allocate and set more bytes than requested
     if(!use_pool) {
@@ -406,6 +417,14 @@ bool buffer::empty () const
 void buffer::clear ()
 {
     size_ = 0;
+    rewind();
+}
+
+void buffer::rewind () noexcept
+{
+    data_ -= head_;
+    capacity_ += head_;
+    head_ = 0;
 }
 
 unsigned char* buffer::data ()
@@ -505,6 +524,28 @@ void buffer::flush(buffer::size_type b) {
 
 }
 
+void buffer::consume(buffer::size_type bytes) {
+
+    if (bytes >= size_) {
+        clear();
+        return;
+    }
+
+    data_ += bytes;
+    size_ -= bytes;
+    capacity_ -= bytes;
+    head_ += bytes;
+}
+
+void buffer::compact() {
+    if (head_ == 0) return;
+
+    if (size_ > 0) {
+        std::memmove(data_ - head_, data_, size_);
+    }
+    rewind();
+}
+
 buffer buffer::view(size_type pos, buffer::size_type len) const {
     if (pos < size_) {
         // starting pos in the buffer
@@ -24,11 +24,6 @@
 #include <display.hpp>
 #include <mempool/mempool.hpp>
 
-#ifdef SOCLE_MEM_PROFILE
-#include <unordered_map>
-#include <mutex>
-#endif
-
 #include <log/logan.hpp>
 #include <ostream>
 
@@ -47,16 +42,6 @@ public:
   static inline bool use_pool = true;
 
 
-#ifdef SOCLE_MEM_PROFILE  
-  static std::unordered_map<std::string,int> alloc_map;
-  static std::mutex alloc_map_lock_;
-  std::string my_bt;
-  void counter_alloc_bt();
-  void counter_free_bt();
-  static void counter_clear_bt();
-  static inline void alloc_map_lock() { alloc_map_lock_.lock(); };
-  static inline void alloc_map_unlock() { alloc_map_lock_.unlock(); };
-#endif
   static void counter_alloc(size_type s);
   static void counter_free(size_type s);
 
@@ -80,6 +65,7 @@ public:
           data_ = ref.data_;
           capacity_ = ref.capacity_;
           size_ = ref.size_;
+          head_ = ref.head_;
 
           free_ = ref.free_;
 
@@ -89,15 +75,8 @@ public:
 
   buffer& operator= (buffer&& ref) noexcept {
 
-      if (free_ and data_ != nullptr ) {
-          if(use_pool) {
-
-              memPool::pool().release( { data_, capacity_} );
-          }
-          else {
-              delete[] data_;  // we HAD ownership
-              counter_free(capacity_);
-          }
+      if (data_ != nullptr) {
+          dealloc();  // only if we HAD ownership
       }
 
       // auto log = logan::create("buffer");
@@ -106,6 +85,7 @@ public:
       data_ = ref.data_;
       capacity_ = ref.capacity_;
       size_ = ref.size_;
+      head_ = ref.head_;
 
       free_ = ref.free_;
 
@@ -138,6 +118,7 @@ public:
   [[nodiscard]] size_type size () const;
   [[nodiscard]] bool empty () const;
   [[nodiscard]] size_type capacity () const;
+  [[nodiscard]] bool owner () const { return free_; }   // we free data on destruction
 
   bool size (size_type);
   bool capacity (size_type);
@@ -172,6 +153,13 @@ public:
   [[nodiscard]] std::string_view string_view() const;
   
   void flush (size_type);
+
+  // consume bytes from the front without moving the rest: data() just advances. Space in front (headroom) is
+  // reclaimed when buffer gets empty, or when more capacity is requested - before anything is reallocated.
+  // Note capacity() counts from data(), so it shrinks by consumed bytes until then.
+  void consume (size_type);
+  [[nodiscard]] size_type headroom () const { return head_; }
+  void compact ();
   buffer view(size_type pos, buffer::size_type len) const;
   buffer view() const;
   buffer view(size_type pos) const { return view(pos, size() - pos); };
@@ -182,7 +170,10 @@ private:
   unsigned char* data_ = nullptr;
   size_type size_ = 0;
   size_type capacity_ = 0;
+  size_type head_ = 0;    // consumed bytes in front of data_, still part of allocation
   bool free_ = true;
+
+  void rewind () noexcept;
 };
 
 bool operator== (const buffer&, const buffer&);
@@ -197,9 +188,6 @@ inline void buffer::counter_alloc(size_type s) {
     if(s > 0) {
         alloc_bytes += s;
         alloc_count++;
-#ifdef SOCLE_MEM_PROFILE
-        counter_alloc_bt();
-#endif
     }    
 }
 
@@ -207,42 +195,9 @@ inline void buffer::counter_free(size_type s) {
     if(s > 0) {
         free_bytes += s;
         free_count++;
-#ifdef SOCLE_MEM_PROFILE
-        counter_free_bt();
-#endif
     }    
 }
 
-#ifdef SOCLE_MEM_PROFILE  
-inline void buffer::counter_alloc_bt() {
-    if(my_bt.size() > 0) {
-        counter_free_bt();
-    }
-    my_bt = bt();
-    
-    std::lock_guard<std::mutex> l(alloc_map_lock_);
-    auto it = alloc_map.find(my_bt);
-    if(it == alloc_map.end()) {
-        alloc_map[my_bt] = 0;
-    }
-    alloc_map[my_bt]++;
-}
-inline void buffer::counter_free_bt() {
-    std::lock_guard<std::mutex> l(alloc_map_lock_);
-    auto it = alloc_map.find(my_bt);
-    
-    if(it == alloc_map.end()) {
-        alloc_map[my_bt] = 0;
-    } else {
-        alloc_map[my_bt]--;
-    }
-}
-inline void buffer::counter_clear_bt() {
-    std::lock_guard<std::mutex> l(alloc_map_lock_);
-    alloc_map.clear();
-}
-
-#endif
 
 
 template <typename T>
@@ -0,0 +1,96 @@
+#ifndef BUFFERSLICE_HPP
+#define BUFFERSLICE_HPP
+
+#include <memory>
+
+#include <buffer.hpp>
+
+/// @brief reference-counted read-only window into a shared buffer.
+/// Copies of a slice share the same bytes, memory goes back to memPool when the last slice is gone. Unlike
+/// buffer::view(), a slice keeps its data alive. Consuming a slice only moves its own window.
+class buffer_slice {
+public:
+    using size_type = buffer::size_type;
+
+    buffer_slice() = default;
+
+    /// @brief take over content of 'b' without copying, 'b' is left empty with the same capacity.
+    /// Non-owning buffers (views) are copied.
+    static buffer_slice take(buffer& b) {
+        buffer_slice ret;
+        if(b.empty()) return ret;
+
+        if(not b.owner()) {
+            ret = buffer_slice(b.data(), b.size());
+            b.clear();
+            return ret;
+        }
+
+        auto cap = b.capacity() + b.headroom();
+        auto holder = std::make_shared<buffer>();
+        holder->swap(b);
+        b.capacity(cap);
+
+        ret.len_ = holder->size();
+        ret.buf_ = std::move(holder);
+        return ret;
+    }
+
+    /// @brief slice of a copy of 'data'
+    buffer_slice(const void* data, size_type len) : buf_(std::make_shared<buffer>(data, len)), len_(len) {}
+
+    [[nodiscard]] unsigned char const* data() const { return buf_ ? buf_->data() + off_ : nullptr; }
+    [[nodiscard]] size_type size() const { return len_; }
+    [[nodiscard]] bool empty() const { return len_ == 0; }
+
+    /// @brief drop bytes from the front of this slice
+    void consume(size_type n) {
+        if(n >= len_) {
+            reset();
+            return;
+        }
+        off_ += n;
+        len_ -= n;
+    }
+
+    [[nodiscard]] buffer_slice sub(size_type pos, size_type len = buffer::npos) const {
+        buffer_slice ret;
+        if(pos >= len_) return ret;
+
+        ret.buf_ = buf_;
+        ret.off_ = off_ + pos;
+        ret.len_ = std::min(len, len_ - pos);
+        return ret;
+    }
+
+    /// @brief append in place, possible only if nobody else shares the buffer and slice reaches its end
+    bool append(const void* data, size_type len) {
+        if(not buf_ or buf_.use_count() != 1 or off_ + len_ != buf_->size()) return false;
+        if(buf_->capacity() - buf_->size() < len) return false;
+
+        buf_->append(data, len);
+        len_ += len;
+        return true;
+    }
+
+    /// @brief non-owning view, valid only while this slice exists
+    [[nodiscard]] buffer view() const {
+        if(empty()) return buffer();
+        return buf_->view(off_, len_);
+    }
+
+    [[nodiscard]] long use_count() const { return buf_.use_count(); }
+
+    void reset() {
+        buf_.reset();
+        off_ = 0;
+        len_ = 0;
+    }
+
+private:
+    std::shared_ptr<buffer> buf_;
+    size_type off_ = 0;
+    size_type len_ = 0;
+};
+
+#endif //BUFFERSLICE_HPP
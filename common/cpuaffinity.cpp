@@ -0,0 +1,315 @@
+/*
+    Socle - Socket Library Ecosystem
+    Copyright (c) 2014, Ales Stibal <astib@mag0.net>, All rights reserved.
+
+    This library  is free  software;  you can redistribute  it and/or
+    modify  it  under   the  terms of the  GNU Lesser  General Public
+    License  as published by  the   Free Software Foundation;  either
+    version 3.0 of the License, or (at your option) any later version.
+    This library is  distributed  in the hope that  it will be useful,
+    but WITHOUT ANY WARRANTY;  without  even  the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the GNU Lesser General Public License for more details.
+
+    You  should have received a copy of the GNU Lesser General Public
+    License along with this library.
+*/
+
+#include <cpuaffinity.hpp>
+#include <display.hpp>
+#include <log/logan.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <tuple>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+
+    struct cpu_info {
+        int id = 0;
+        int node = 0;
+        int package = 0;
+        int core = 0;
+        int sibling = 0;    // order among hyper-threads of the same core
+    };
+
+    int read_int(std::string const& path, int def) {
+        std::ifstream f(path);
+        std::string line;
+        if(not std::getline(f, line)) return def;
+        return safe_val(line, def);
+    }
+
+    // "0-3,8-11" -> 0,1,2,3,8,9,10,11
+    std::vector<int> parse_cpulist(std::string const& str) {
+        std::vector<int> ret;
+
+        std::size_t pos = 0;
+        while(pos < str.size()) {
+            auto end = str.find(',', pos);
+            if(end == std::string::npos) end = str.size();
+
+            auto range = str.substr(pos, end - pos);
+            auto dash = range.find('-');
+            auto from = safe_val(range.substr(0, dash));
+            auto to = dash == std::string::npos ? from : safe_val(range.substr(dash + 1));
+            for(int i = from; i >= 0 and i <= to; ++i) ret.push_back(i);
+
+            pos = end + 1;
+        }
+        return ret;
+    }
+
+    std::vector<cpu_info> const& topology() {
+        static const std::vector<cpu_info> cpus = [] {
+            std::vector<cpu_info> ret;
+
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if(::sched_getaffinity(0, sizeof(set), &set) != 0) return ret;
+
+            std::map<int, int> node_of;
+            for(int n = 0; n < 64; ++n) {
+                std::ifstream f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+                std::string line;
+                if(not std::getline(f, line)) continue;
+                for(auto c: parse_cpulist(line)) node_of[c] = n;
+            }
+
+            std::map<std::tuple<int,int>, int> siblings;
+            for(int c = 0; c < CPU_SETSIZE; ++c) {
+                if(not CPU_ISSET(c, &set)) continue;
+
+                cpu_info ci;
+                ci.id = c;
+                ci.node = node_of.count(c) ? node_of[c] : 0;
+
+                auto base = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+                ci.package = read_int(base + "physical_package_id", 0);
+                ci.core = read_int(base + "core_id", c);
+                ci.sibling = siblings[{ ci.package, ci.core }]++;
+
+                ret.push_back(ci);
+            }
+
+            return ret;
+        }();
+
+        return cpus;
+    }
+
+    std::vector<int> nodes() {
+        std::vector<int> ret;
+        for(auto const& c: topology()) {
+            if(std::find(ret.begin(), ret.end(), c.node) == ret.end()) ret.push_back(c.node);
+        }
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    // allowed CPUs of 'node', distinct cores first
+    std::vector<int> node_cpus(int node) {
+        std::vector<cpu_info> sel;
+        for(auto const& c: topology()) if(c.node == node) sel.push_back(c);
+
+        std::sort(sel.begin(), sel.end(), [](auto const& a, auto const& b) {
+            return std::tie(a.sibling, a.package, a.core, a.id) < std::tie(b.sibling, b.package, b.core, b.id);
+        });
+
+        std::vector<int> ret;
+        for(auto const& c: sel) ret.push_back(c.id);
+        return ret;
+    }
+}
+
+cpu_affinity::policy_t& cpu_affinity::policy() {
+    static policy_t p = [] {
+        auto const* env = std::getenv("SX_CPU_AFFINITY");
+        return env ? parse(env) : policy_t::NONE;
+    }();
+    return p;
+}
+
+cpu_affinity::policy_t cpu_affinity::parse(std::string const& str) {
+    if(str == "compact") return policy_t::COMPACT;
+    if(str == "spread") return policy_t::SPREAD;
+    if(str == "node" or str == "numa") return policy_t::NODE;
+    return policy_t::NONE;
+}
+
+const char* cpu_affinity::policy_str(policy_t p) {
+    switch(p) {
+        case policy_t::NONE:
+            return "none";
+        case policy_t::COMPACT:
+            return "compact";
+        case policy_t::SPREAD:
+            return "spread";
+        case policy_t::NODE:
+            return "node";
+    }
+    return "unknown";
+}
+
+std::size_t cpu_affinity::allowed_count() {
+    return std::max<std::size_t>(topology().size(), 1);
+}
+
+std::size_t cpu_affinity::worker_count() {
+    auto n = allowed_count();
+    if(policy() == policy_t::NONE or n == 1) return n;
+
+    // one CPU is left for service threads
+    return n - 1;
+}
+
+std::vector<int> cpu_affinity::order() {
+    std::vector<int> ret;
+    auto const& topo = topology();
+
+    switch(policy()) {
+        case policy_t::NONE:
+        case policy_t::NODE:
+            break;
+
+        case policy_t::COMPACT: {
+            auto sorted = topo;
+            std::sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) {
+                return std::tie(a.node, a.package, a.core, a.sibling, a.id)
+                       < std::tie(b.node, b.package, b.core, b.sibling, b.id);
+            });
+            for(auto const& c: sorted) ret.push_back(c.id);
+            break;
+        }
+
+        case policy_t::SPREAD: {
+            // round-robin over nodes, nodes with less CPUs are skipped when exhausted
+            std::vector<std::vector<int>> per_node;
+            for(auto n: nodes()) per_node.push_back(node_cpus(n));
+
+            for(std::size_t k = 0; ret.size() < topo.size(); ++k) {
+                for(auto const& cpus: per_node) {
+                    if(k < cpus.size()) ret.push_back(cpus[k]);
+                }
+            }
+            break;
+        }
+    }
+
+    return ret;
+}
+
+std::vector<int> cpu_affinity::cpus_for(std::size_t index) {
+
+    if(topology().empty()) return {};
+
+    if(policy() == policy_t::NODE) {
+        auto all = nodes();
+        return node_cpus(all[index % all.size()]);
+    }
+
+    auto cpus = order();
+    if(cpus.empty()) return {};
+
+    // the last one is reserved for services
+    return { cpus[index % worker_count()] };
+}
+
+std::vector<int> cpu_affinity::cpus_for_service() {
+
+    if(topology().empty()) return {};
+
+    if(policy() == policy_t::NODE) {
+        return node_cpus(nodes().back());
+    }
+
+    auto cpus = order();
+    if(cpus.empty()) return {};
+
+    return { cpus.back() };
+}
+
+std::vector<int> cpu_affinity::current() {
+    std::vector<int> ret;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set) != 0) return ret;
+
+    for(int c = 0; c < CPU_SETSIZE; ++c) {
+        if(CPU_ISSET(c, &set)) ret.push_back(c);
+    }
+    return ret;
+}
+
+std::vector<int> cpu_affinity::worker_of_cpu(std::size_t workers) {
+    std::vector<int> ret;
+    if(policy() == policy_t::NONE or topology().empty()) return ret;
+
+    std::vector<std::vector<int>> placed(workers);
+    for(std::size_t i = 0; i < workers; ++i) placed[i] = cpus_for(i);
+
+    int max_id = 0;
+    for(auto const& c: topology()) max_id = std::max(max_id, c.id);
+    ret.assign(max_id + 1, -1);
+
+    std::vector<std::size_t> load(workers, 0);
+    for(auto const& c: topology()) {
+        int best = -1;
+        for(std::size_t i = 0; i < workers; ++i) {
+            if(std::find(placed[i].begin(), placed[i].end(), c.id) == placed[i].end()) continue;
+            if(best < 0 or load[i] < load[best]) best = static_cast<int>(i);
+        }
+        if(best < 0) continue;
+
+        ret[c.id] = best;
+        ++load[best];
+    }
+
+    return ret;
+}
+
+bool cpu_affinity::pin(std::vector<int> const& cpus) {
+    if(cpus.empty()) return false;
+
+    static logan_lite log {"cpu.affinity"};
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(auto c: cpus) CPU_SET(c, &set);
+
+    auto ret = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    if(ret != 0) {
+        _err("cpu_affinity::pin: pthread_setaffinity_np failed: %s", string_error(ret).c_str());
+        return false;
+    }
+
+    _dia("cpu_affinity::pin: thread pinned to %d cpus, first %d (%s)", cpus.size(), cpus.front(),
+         policy_str(policy()));
+    return true;
+}
+
+bool cpu_affinity::apply(std::size_t index) {
+    return pin(cpus_for(index));
+}
+
+bool cpu_affinity::apply_service() {
+    return pin(cpus_for_service());
+}
+
+cpu_affinity::service_scope::service_scope() {
+    if(policy() == policy_t::NONE) return;
+
+    saved_ = current();
+    if(not apply_service()) saved_.clear();
+}
+
+cpu_affinity::service_scope::~service_scope() {
+    pin(saved_);
+}
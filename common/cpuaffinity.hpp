@@ -0,0 +1,78 @@
+/*
+    Socle - Socket Library Ecosystem
+    Copyright (c) 2014, Ales Stibal <astib@mag0.net>, All rights reserved.
+
+    This library  is free  software;  you can redistribute  it and/or
+    modify  it  under   the  terms of the  GNU Lesser  General Public
+    License  as published by  the   Free Software Foundation;  either
+    version 3.0 of the License, or (at your option) any later version.
+    This library is  distributed  in the hope that  it will be useful,
+    but WITHOUT ANY WARRANTY;  without  even  the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the GNU Lesser General Public License for more details.
+
+    You  should have received a copy of the GNU Lesser General Public
+    License along with this library.
+*/
+
+#ifndef CPUAFFINITY_HPP
+#define CPUAFFINITY_HPP
+
+#include <string>
+#include <vector>
+
+/// @brief thread placement policies. Threads are numbered by their caller (worker id), slot of each thread
+/// is computed from CPUs the process is allowed to run on and their NUMA/core topology:
+/// - compact: slot i is i-th CPU ordered by node, core and hyper-thread sibling - threads share caches
+/// - spread:  slots go round-robin over nodes, on each node distinct cores come before siblings
+/// - node:    slot i is whole CPU set of node (i % nodes), scheduler moves the thread only within the node
+/// Service threads (acceptor, writers) get the last CPU in that order, workers don't get it unless it's the only one.
+/// With node policy services run on CPU set of the last node.
+struct cpu_affinity {
+
+    enum class policy_t { NONE = 0, COMPACT, SPREAD, NODE };
+
+    // initial value from SX_CPU_AFFINITY environment variable ("compact", "spread", "node")
+    static policy_t& policy();
+
+    static policy_t parse(std::string const& str);
+    static const char* policy_str(policy_t p);
+
+    /// @return CPUs for thread 'index', empty if policy is NONE
+    static std::vector<int> cpus_for(std::size_t index);
+    static std::vector<int> cpus_for_service();
+
+    /// pin calling thread. @return true if pinned
+    static bool apply(std::size_t index);
+    static bool apply_service();
+
+    /// pins thread we don't own (ie. caller of acceptor's run()) to service CPUs, restores its affinity when done
+    struct service_scope {
+        service_scope();
+        ~service_scope();
+
+        service_scope(service_scope const&) = delete;
+        service_scope& operator=(service_scope const&) = delete;
+    private:
+        std::vector<int> saved_;
+    };
+
+    /// @return worker index for each CPU id (-1 if no worker of 'workers' runs there), empty if policy is NONE.
+    /// CPU shared by more workers (node policy, more workers than CPUs) goes to the one having fewest CPUs so far.
+    static std::vector<int> worker_of_cpu(std::size_t workers);
+
+    /// number of CPUs process may use (sched_getaffinity), at least 1
+    static std::size_t allowed_count();
+    /// allowed CPUs without the one reserved for services (if policy pins threads), at least 1
+    static std::size_t worker_count();
+
+private:
+    static bool pin(std::vector<int> const& cpus);
+    // CPUs in order of compact/spread slots, empty for other policies
+    static std::vector<int> order();
+    // affinity of calling thread
+    static std::vector<int> current();
+};
+
+#endif //CPUAFFINITY_HPP
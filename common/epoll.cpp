@@ -1,4 +1,5 @@
 #include <epoll.hpp>
+#include <uring.hpp>
 #include <hostcx.hpp>
 
 
@@ -11,7 +12,7 @@ int epoll::init() {
     if (s == -1) {
         _err("epoll::init:%x: epoll_create failed! errno %d", this, errno);
     }
-    rescan_timer = std::chrono::high_resolution_clock::now();
+    edge_triggered = default_edge_triggered;
 
     return s;
 }
@@ -47,6 +48,18 @@ int epoll::process_epoll_events(int nfds) {
         int socket = events[i].data.fd;
         uint32_t eventset = events[i].events;
 
+        // edge-triggered sockets report both directions at once, and we won't get another edge for any of them
+        if(edge_triggered and socket != hint_socket() and eventset & (EPOLLIN|EPOLLOUT)) {
+            _dia("epoll::wait: edge on socket %d, r=%d, w=%d", socket, flag_check<uint32_t>(eventset, EPOLLIN),
+                                                                        flag_check<uint32_t>(eventset, EPOLLOUT));
+
+            if(eventset & EPOLLIN) in_set.insert(socket);
+            if(eventset & EPOLLOUT) out_set.insert(socket);
+            clear_idle_watch(socket);
+
+            continue;
+        }
+
         if(eventset & EPOLLIN) {
             if (socket == hint_socket()) {
                 _dia("epoll::wait: hint triggered %d", socket);
@@ -82,96 +95,17 @@ int epoll::process_epoll_events(int nfds) {
     return i;
 }
 
-void epoll::process_pre_wait_idles() {
-    // idle timer?
-    if(idle_counter > idle_timeout_ms) {
-        idle_counter = 0;
-
-        // toggle idle round
-        idle_round = not idle_round;
-
-        if(not idle_round) {
-
-            mp::set<int> cp;
-            {
-                auto l = std::scoped_lock(idle_watched_pre.get_lock());
-
-                // moving _pre to idle_watched
-                if (!idle_watched_pre.empty_ul())
-                    _deb("epoll::wait: idle round %d, moving %d sockets to idle watch", idle_round,
-                         idle_watched_pre.size_ul());
-
-                for (auto s: idle_watched_pre.get_ul()) {
-                    cp.insert(s);
-                }
-                idle_watched_pre.clear_ul();
-            }
-            for(auto s: cp)
-                idle_watched.insert(s);
-
-
-        } else {
-
-            mp::set<int> cp;
-            {
-                auto l = std::scoped_lock(idle_watched.get_lock());
-
-                // finally idle sockets
-                if(! idle_watched.empty_ul())
-                    _dia("epoll::wait: idle round %d, %d sockets marked idle", idle_round, idle_watched.size_ul());
-
-                for (auto s: idle_watched.get_ul()) {
-                    _dia("epoll::wait: idle socket %d", s);
-
-                    cp.insert(s);
-                }
-                idle_watched.clear_ul();
-            }
-            for(auto s: cp)
-                idle_set.insert(s);
-        }
-    }
-}
-
-void epoll::process_pre_wait_rescans() {
-    // Setting up rescans!
-    {
-        auto l_ = std::scoped_lock(rescan_set_in.get_lock());
-
-        for (auto isock: rescan_set_in.get_ul()) {
-            _deb("epoll::wait rescanning EPOLLIN socket %d", isock);
-            add(isock, EPOLLIN);
-        }
-        rescan_set_in.clear_ul();
-    }
-
-    {
-        auto l_ = std::scoped_lock(rescan_set_out.get_lock());
-
-        for (auto osock: rescan_set_out.get_ul()) {
-            _deb("epoll::wait rescanning EPOLLIN|OUT socket %d", osock);
-            add(osock, EPOLLIN | EPOLLOUT);
-        }
-        rescan_set_out.clear_ul();
-    }
-}
-
 void epoll::enforced_to_inset() {
-    mp::set<int> cp;
-    {
-        auto l_ = std::scoped_lock(enforce_in_set.get_lock());
 
-        if (!enforce_in_set.empty_ul()) {
-            _dia("epoll::wait: enforced sockets set active");
-            for (auto enforced_fd: enforce_in_set.get_ul()) {
-                cp.insert(enforced_fd);
-                _deb("epoll::wait: enforced socket %dr", enforced_fd);
-            }
-            enforce_in_set.clear_ul();
+    auto l_ = std::scoped_lock(enforce_in_set.get_lock(), in_set.get_lock());
+
+    if (!enforce_in_set.empty_ul()) {
+        _dia("epoll::wait: enforced sockets set active");
+        for (auto enforced_fd: enforce_in_set.get_ul()) {
+            in_set.insert_ul(enforced_fd);
+            _deb("epoll::wait: enforced socket %dr", enforced_fd);
         }
-    }
-    for(auto s: cp) {
-        in_set.insert(s);
+        enforce_in_set.clear_ul();
     }
 }
 
@@ -182,6 +116,7 @@ void epoll::clear() {
     in_set.clear();
     out_set.clear();
     idle_set.clear();
+    idle_virt_set.clear();
     err_set.clear();
 }
 
@@ -191,15 +126,31 @@ int epoll::wait(long timeout) {
 
     clear();
     
-    // Pre-populate epoll from rescan lists
-    
-    if(click_timer_now()) {
-        process_pre_wait_rescans();
-        process_pre_wait_idles();
+    // rescans due now are re-added before waiting
+    process_timers();
+
+    // don't sleep over the nearest deadline
+    auto next = next_timeout();
+    if(next >= 0 and (timeout < 0 or next < timeout)) {
+        _ext("epoll::wait: timeout shortened to %dms by timers", next);
+        timeout = next;
     }
-    
+
     // wait for epoll
-    
+
+    int nfds = poll_events(timeout);
+    if(nfds < 0) {
+        return nfds;
+    }
+
+    process_timers();
+    enforced_to_inset();
+
+    return nfds;
+}
+
+int epoll::poll_events(long timeout) {
+
     int nfds = 0;
     int cur_nfds = 0;
     unsigned count = 0;
@@ -216,27 +167,35 @@ int epoll::wait(long timeout) {
 
         // optimized-out in Release builds
         _if_deb {
-            _debug_sockets(nfds);
+            _debug_sockets(cur_nfds);
         }
 
-        int proc = process_epoll_events(nfds);
+        int proc = process_epoll_events(cur_nfds);
         _deb("epoll::wait: processed %d from %d ready sockets - round %d", proc, nfds, count);
 
         count++;
 
-    } while (cur_nfds == EPOLLER_MAX_EVENTS);
+        // more events may be pending, but don't block for them
+        timeout = 0;
 
-    enforced_to_inset();
+    } while (cur_nfds == EPOLLER_MAX_EVENTS);
 
     _dum("epoll::wait: == end, %d loops", count);
     return nfds;
 }
 
+int epoll::effective_mask(int socket, int mask) const {
+    if(edge_triggered and socket != hint_socket()) {
+        return EPOLLIN | EPOLLOUT | EPOLLET;
+    }
+    return mask;
+}
+
 bool epoll::add(int socket, int mask) {
     struct epoll_event ev;
     memset(&ev,0,sizeof ev);
     
-    ev.events = mask;
+    ev.events = effective_mask(socket, mask);
     ev.data.fd = socket;
 
     int fd = epoll_socket();
@@ -254,15 +213,25 @@ bool epoll::add(int socket, int mask) {
     } else {
         _deb("epoll:add:%x: epoll_ctl(%d): socket added %d",this, fd, socket);
     }
+
+    if(edge_triggered and socket != hint_socket()) {
+        et_registered.insert(socket);
+    }
     
     return true;
 }
 
 bool epoll::modify(int socket, int mask) {
 
+    // edge-triggered sockets are monitored for both directions since registration
+    if(edge_triggered and et_registered.find(socket)) {
+        _ext("epoll:modify:%x: socket %d edge-triggered, nothing to modify", this, socket);
+        return true;
+    }
+
     int fd = epoll_socket();
     epoll_event ev{};
-    ev.events = mask;
+    ev.events = effective_mask(socket, mask);
     ev.data.fd = socket;
 
     _deb("epoll:modify:%x: epoll_ctl(%d): called to modify socket %d, epollin=%d,epollout=%d ",this, fd, socket,flag_check<int>(mask,EPOLLIN),flag_check<int>(mask,EPOLLOUT));
@@ -295,6 +264,8 @@ bool epoll::del(int socket) {
     ev.data.fd = socket;
     
     _deb("epoll:del:%x: epoll_ctl(%d): called to delete socket %d ",this, fd, socket);
+
+    et_registered.erase(socket);
     
     if (::epoll_ctl(fd, EPOLL_CTL_DEL, socket, &ev) == -1) {
 
@@ -316,11 +287,14 @@ bool epoll::in_write_set(int check) {
 }
 
 bool epoll::in_idle_set(int check) {
+    if(check < 0) {
+        return idle_virt_set.find(check);
+    }
     return idle_set.find(check);
 }
 
 bool epoll::in_idle_watched_set(int check) {
-    return idle_watched.find(check);
+    return timer_pending(check, timer_kind::IDLE_WATCH);
 }
 
 
@@ -332,19 +306,18 @@ bool epoll::hint_socket(int socket) {
 
         int h_fd = hint_socket();
 
-        struct epoll_event rem_ev;
-        rem_ev.events = EPOLLIN;
-        rem_ev.data.fd = hint_socket();
-        
         _dia("epoll:hint_socket:%x: epoll_ctl(%d): removing old hint socket %d",this, fd,hint_socket());
-        ::epoll_ctl(fd,EPOLL_CTL_DEL, h_fd, &rem_ev);
+        del(h_fd);
     }
-    
+
+    // set before add(), so hint socket is registered level-triggered
+    hint_fd_ = socket;
+
     if(add(socket,EPOLLIN)) {
         _dia("epoll:hint_socket:%x: epoll_ctl(%d): setting hint socket %d",this, fd, socket);
-        hint_fd_ = socket;
 
     } else {
+        hint_fd_ = 0;
         _dia("epoll:hint_socket:%x: epoll_ctl(%d): setting hint socket %d FAILED.",this, fd, socket);
         return false;
     }
@@ -353,20 +326,20 @@ bool epoll::hint_socket(int socket) {
 
 
 bool epoll::rescans_empty() const {
-    return ( rescan_set_in.empty() and rescan_set_out.empty() );
+    return rescans_armed_ == 0;
+}
+
+bool epoll::enforced_empty() const {
+    return enforce_in_set.empty();
 }
 
 bool epoll::rescan_in(int socket) {
     if(socket > 0) {
 
         del(socket);
-        
-        // re-init timer, otherwise let it be
-        if(rescan_set_in.empty()) {
-            rescan_timer = std::chrono::high_resolution_clock::now();
-        }
-        
-        rescan_set_in.insert(socket);
+
+        // already pending rescan: let it be
+        arm_timer(socket, timer_kind::RESCAN_IN, baseCom::rescan_msec);
         return true;
     }
     
@@ -383,7 +356,7 @@ bool epoll::enforce_in(int socket) {
 
 unsigned long epoll::cancel_rescan_in(int socket) {
     if(socket > 0) {
-        return rescan_set_in.erase(socket);
+        return cancel_timer(socket, timer_kind::RESCAN_IN) ? 1L : 0L;
     }
 
     return 0L;
@@ -395,13 +368,8 @@ bool epoll::rescan_out(int socket) {
     if(socket > 0) {
 
         del(socket);
-        
-        // re-init timer, otherwise let it be
-        if(rescan_set_out.empty()) {
-            rescan_timer = std::chrono::high_resolution_clock::now();
-        }
-        
-        rescan_set_out.insert(socket);
+
+        arm_timer(socket, timer_kind::RESCAN_OUT, baseCom::rescan_msec);
         return true;
     }
     
@@ -410,7 +378,7 @@ bool epoll::rescan_out(int socket) {
 
 unsigned long epoll::cancel_rescan_out(int socket) {
     if(socket > 0) {
-        return rescan_set_out.erase(socket);
+        return cancel_timer(socket, timer_kind::RESCAN_OUT) ? 1L : 0L;
     }
 
     return 0L;
@@ -418,44 +386,170 @@ unsigned long epoll::cancel_rescan_out(int socket) {
 
 
 bool epoll::click_timer_now () {
+    return process_timers() > 0;
+}
 
-    auto now = std::chrono::high_resolution_clock::now();
+void epoll::set_idle_watch(int check){
+    arm_timer(check, timer_kind::IDLE_WATCH, idle_timeout_ms);
+}
 
-    
-    auto ms_diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - rescan_timer).count();
-    if(ms_diff > baseCom::rescan_msec) {
-        rescan_timer = now;
-        _ext("epoll::click_timer_now: diff = %d",ms_diff);
-
-        idle_counter += ms_diff;
-        if(idle_counter > idle_timeout_ms) {
-            _ext("epoll::click_timer_now: idle counter = %d",idle_counter);
-        }
-        return true;
+unsigned long epoll::clear_idle_watch(int check) {
+
+    // called on each socket event, don't lock if there is nothing to clear
+    if(idle_watches_armed_ == 0) return 0L;
+
+    if(cancel_timer(check, timer_kind::IDLE_WATCH)) {
+        _deb("epoll::clear_idle_watch %d -> cleared", check);
+        return 1L;
     }
-    return false;
+
+    return 0L;
 }
 
-void epoll::set_idle_watch(int check){
-    idle_watched_pre.insert(check);
+void epoll::set_idle_deadline(int socket, long timeout_ms) {
+    auto l_ = std::scoped_lock(timers_lock_);
+
+    auto* h = handles_ul(socket, true);
+    if(not h) return;
+
+    auto& handle = (*h)[static_cast<std::size_t>(timer_kind::IDLE_DEADLINE)];
+    timers_.cancel(handle);
+    handle = timers_.arm(static_cast<timer_wheel_type::tick_type>(std::max(timeout_ms, 0L)),
+                         { socket, timer_kind::IDLE_DEADLINE }, timer_wheel_type::clock_ms());
+
+    _ext("epoll::set_idle_deadline: socket %d in %dms", socket, timeout_ms);
 }
 
-unsigned long epoll::clear_idle_watch(int check) {
+void epoll::cancel_timers(int socket) {
+    for(auto k = 0; k < static_cast<int>(timer_kind::MAX); ++k) {
+        cancel_timer(socket, static_cast<timer_kind>(k));
+    }
+}
+
+long epoll::next_timeout() const {
+    auto l_ = std::scoped_lock(timers_lock_);
+
+    return timers_.next_timeout(timer_wheel_type::clock_ms());
+}
 
-    unsigned long ret = 0L;
+epoll::timer_handles* epoll::handles_ul(int socket, bool create) {
 
-    unsigned long ip = idle_watched_pre.erase(check);
-    unsigned long iw = 0;
-    if (ip <= 0) {
-        iw = idle_watched.erase(check);
+    if(socket < 0) {
+        auto it = virt_timer_handles_.find(socket);
+        if(it != virt_timer_handles_.end()) return &it->second;
+        if(not create) return nullptr;
+
+        auto& h = virt_timer_handles_[socket];
+        h.fill(timer_wheel_type::null_handle);
+        return &h;
+    }
+
+    auto idx = static_cast<std::size_t>(socket);
+    if(idx >= timer_handles_.size()) {
+        if(not create) return nullptr;
+
+        timer_handles empty;
+        empty.fill(timer_wheel_type::null_handle);
+        timer_handles_.resize(std::max(idx + 1, timer_handles_.size() * 2), empty);
     }
-    if (ip > 0) {
-        _deb("epoll::clear_handler %d -> clearing idle watchlist [pre: %ld list: %ld]", check, ip, iw);
+    return &timer_handles_[idx];
+}
+
+bool epoll::arm_timer(int socket, timer_kind kind, long timeout_ms) {
+    auto l_ = std::scoped_lock(timers_lock_);
+
+    auto* h = handles_ul(socket, true);
+    if(not h) return false;
+
+    auto& handle = (*h)[static_cast<std::size_t>(kind)];
+    if(timers_.pending(handle)) return false;
+
+    handle = timers_.arm(static_cast<timer_wheel_type::tick_type>(std::max(timeout_ms, 0L)), { socket, kind },
+                         timer_wheel_type::clock_ms());
+
+    if(kind == timer_kind::IDLE_WATCH) ++idle_watches_armed_;
+    else if(kind == timer_kind::RESCAN_IN or kind == timer_kind::RESCAN_OUT) ++rescans_armed_;
+
+    return true;
+}
+
+bool epoll::cancel_timer(int socket, timer_kind kind) {
+    auto l_ = std::scoped_lock(timers_lock_);
+
+    auto* h = handles_ul(socket, false);
+    if(not h) return false;
+
+    auto& handle = (*h)[static_cast<std::size_t>(kind)];
+    bool cancelled = timers_.cancel(handle);
+    handle = timer_wheel_type::null_handle;
+
+    if(cancelled) {
+        if(kind == timer_kind::IDLE_WATCH) --idle_watches_armed_;
+        else if(kind == timer_kind::RESCAN_IN or kind == timer_kind::RESCAN_OUT) --rescans_armed_;
     }
 
-    ret = iw + ip;
+    // virtual sockets come and go, don't keep their entries around
+    if(socket < 0 and std::all_of(h->begin(), h->end(), [](auto x) { return x == timer_wheel_type::null_handle; })) {
+        virt_timer_handles_.erase(socket);
+    }
+
+    return cancelled;
+}
+
+bool epoll::timer_pending(int socket, timer_kind kind) const {
+    auto l_ = std::scoped_lock(timers_lock_);
+
+    auto* h = const_cast<epoll*>(this)->handles_ul(socket, false);
+    return h and timers_.pending((*h)[static_cast<std::size_t>(kind)]);
+}
+
+std::size_t epoll::process_timers() {
+
+    {
+        auto l_ = std::scoped_lock(timers_lock_);
+
+        timers_expired_.clear();
+        timers_.advance(timer_wheel_type::clock_ms(), [this](timer_key&& key) {
+
+            auto* h = handles_ul(key.socket, false);
+            if(h) (*h)[static_cast<std::size_t>(key.kind)] = timer_wheel_type::null_handle;
+
+            if(key.kind == timer_kind::IDLE_WATCH) --idle_watches_armed_;
+            else if(key.kind == timer_kind::RESCAN_IN or key.kind == timer_kind::RESCAN_OUT) --rescans_armed_;
+
+            timers_expired_.push_back(key);
+        });
+    }
+
+    // act outside of timer lock, add() may need other locks
+    for(auto const& key: timers_expired_) {
+        switch(key.kind) {
+            case timer_kind::RESCAN_IN:
+                _deb("epoll::wait rescanning EPOLLIN socket %d", key.socket);
+                add(key.socket, EPOLLIN);
+                break;
+
+            case timer_kind::RESCAN_OUT:
+                _deb("epoll::wait rescanning EPOLLIN|OUT socket %d", key.socket);
+                add(key.socket, EPOLLIN | EPOLLOUT);
+                break;
+
+            case timer_kind::IDLE_WATCH:
+            case timer_kind::IDLE_DEADLINE:
+                _dia("epoll::wait: idle socket %d", key.socket);
+                if(key.socket < 0) {
+                    idle_virt_set.insert(key.socket);
+                } else {
+                    idle_set.insert(key.socket);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
 
-    return ret;
+    return timers_expired_.size();
 }
 
 
@@ -466,6 +560,20 @@ void epoller::init_if_null()
 
         _deb("creating a new poller instance");
 
+        if(backend == backend_t::URING) {
+            if(uring::supported()) {
+                poller = std::make_unique<uring>();
+                if (poller->init() < 0) {
+                    _err("cannot create io_uring poller, falling back to epoll");
+                    poller = nullptr;
+                }
+            } else {
+                _dia("io_uring poller not supported by kernel, using epoll");
+            }
+        }
+
+        if(poller) return;
+
         poller = std::make_unique<epoll>();
         if (poller->init() < 0) {
             poller = nullptr;
@@ -528,6 +636,33 @@ bool epoller::rescans_empty() {
 
 }
 
+bool epoller::enforced_empty() {
+
+    init_if_null();
+
+    if(poller != nullptr) {
+        return poller->enforced_empty();
+    }
+
+    return true;
+}
+
+void epoller::edge_triggered(bool et) {
+    init_if_null();
+
+    if(poller != nullptr) {
+        poller->edge_triggered = et;
+    }
+}
+
+bool epoller::edge_triggered() const {
+    if(poller != nullptr) {
+        return poller->edge_triggered;
+    }
+
+    return epoll::default_edge_triggered;
+}
+
 bool epoller::rescan_in(int socket)
 {
     init_if_null();
@@ -652,6 +787,14 @@ void epoller::clear_idle_watch(int check){
     }
 }
 
+void epoller::set_idle_deadline(int check, long timeout_ms) {
+    init_if_null();
+
+    if(poller) {
+        poller->set_idle_deadline(check, timeout_ms);
+    }
+}
+
 epoll_handler* epoller::get_handler(int check) {
 
     auto lc_ = std::shared_lock(lock_);
@@ -679,15 +822,30 @@ void epoller::clear_handler(int check) {
     }
 
     if(poller) {
-        unsigned long r = poller->rescan_set_in.erase(check);
-        unsigned long w = poller->rescan_set_out.erase(check);
-        _deb("epoller::clear_handler %d -> clearing rescans [r: %ld w: %ld]",check, r, w);
-
-        poller->clear_idle_watch(check);
+        _deb("epoller::clear_handler %d -> cancelling timers", check);
+        poller->cancel_timers(check);
     }
 }
 
 
+void epoller::release_handler(epoll_handler* h) {
+
+    if(h == nullptr or h->registrant != this) return;
+
+    auto l_ = std::scoped_lock(h->lock_, h->registered_sockets.get_lock());
+
+    for(auto s: h->registered_sockets.get_ul()) {
+        if(get_handler(s) != h) continue;
+
+        _deb("epoller::release_handler: socket %d released from 0x%x", s, h);
+        if(s > 0) del(s);
+        clear_handler(s);
+    }
+
+    h->registered_sockets.clear_ul();
+    h->registrant = nullptr;
+}
+
 void epoller::set_handler(int check, epoll_handler* h) {
 
     if(h != nullptr) {
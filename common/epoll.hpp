@@ -7,6 +7,11 @@
 #include <csignal>
 #include <vector>
 #include <set>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <unordered_map>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -19,6 +24,7 @@
 #include <unistd.h>
 
 #include <mpstd.hpp>
+#include <timerwheel.hpp>
 #include <log/logan.hpp>
 
 #include <shared_mutex>
@@ -115,26 +121,183 @@ private:
     mutable std::recursive_mutex lock_;
 };
 
+
+/// @brief dense, fd-indexed socket set.
+/// Membership is a bitmap indexed by fd, members are also kept in a compact list (with reverse index),
+/// so insert, find and erase are O(1) and clear/iteration cost is proportional to number of members only.
+/// Storage grows with the highest fd seen and is never shrunk. Negative (virtual) sockets are not accepted,
+/// use protected_set for those.
+struct ready_set {
+
+    using word_type = uint64_t;
+    static constexpr std::size_t word_bits = sizeof(word_type) * 8;
+    static constexpr std::size_t initial_capacity = 1024;
+
+    inline std::size_t erase_ul(int e) {
+        if(not find_ul(e)) return 0;
+
+        auto fd = static_cast<std::size_t>(e);
+        bits_[fd / word_bits] &= ~bit(fd);
+
+        // swap with the last member to keep list compact
+        auto idx = index_[fd];
+        auto last = list_.back();
+        list_[idx] = last;
+        index_[static_cast<std::size_t>(last)] = idx;
+        list_.pop_back();
+
+        return 1;
+    }
+
+    inline std::size_t erase(int e) {
+        auto l_ = std::scoped_lock(lock_);
+        return erase_ul(e);
+    }
+
+    inline bool insert_ul(int e) {
+        if(e < 0) return false;
+
+        auto fd = static_cast<std::size_t>(e);
+        if(fd >= index_.size()) grow(fd);
+
+        auto& word = bits_[fd / word_bits];
+        if(word & bit(fd)) return false;
+
+        word |= bit(fd);
+        index_[fd] = static_cast<uint32_t>(list_.size());
+        list_.push_back(e);
+
+        return true;
+    }
+
+    inline bool insert(int e) {
+        auto l_ = std::scoped_lock(lock_);
+        return insert_ul(e);
+    }
+
+    // only words holding members are touched
+    inline void clear_ul() {
+        for(auto fd: list_) {
+            bits_[static_cast<std::size_t>(fd) / word_bits] = 0;
+        }
+        list_.clear();
+    }
+
+    inline void clear() {
+        auto l_ = std::scoped_lock(lock_);
+        clear_ul();
+    }
+
+    inline bool find_ul(int e) const {
+        if(e < 0) return false;
+
+        auto fd = static_cast<std::size_t>(e);
+        if(fd >= index_.size()) return false;
+
+        return (bits_[fd / word_bits] & bit(fd)) != 0;
+    }
+
+    inline bool find(int e) const {
+        auto l_ = std::scoped_lock(lock_);
+        return find_ul(e);
+    }
+
+    inline bool empty_ul() const {
+        return list_.empty();
+    }
+
+    inline bool empty() const {
+        auto l_ = std::scoped_lock(lock_);
+        return list_.empty();
+    }
+
+    inline std::size_t size_ul() const {
+        return list_.size();
+    }
+
+    inline std::size_t size() const {
+        auto l_ = std::scoped_lock(lock_);
+        return list_.size();
+    }
+
+    // iterable list of members, in order of insertion (unless some were erased)
+    inline std::vector<int> const& get_ul() const {
+        return list_;
+    }
+
+    /// @brief copy members to 'out', reusing its capacity. Use it to iterate while set is modified.
+    inline void snapshot(std::vector<int>& out) const {
+        auto l_ = std::scoped_lock(lock_);
+        out.assign(list_.begin(), list_.end());
+    }
+
+    ready_set() = default;
+    ready_set(ready_set const& r) : bits_(r.bits_), index_(r.index_), list_(r.list_) {}
+
+    ready_set& operator=(ready_set const& r) {
+        if(&r != this) {
+            bits_ = r.bits_;
+            index_ = r.index_;
+            list_ = r.list_;
+        }
+        return *this;
+    }
+
+    inline std::recursive_mutex& get_lock() const { return lock_; }
+
+private:
+    static inline word_type bit(std::size_t fd) { return word_type{1} << (fd % word_bits); }
+
+    void grow(std::size_t fd) {
+        auto new_cap = std::max(std::max(index_.size() * 2, initial_capacity), fd + 1);
+        new_cap = ((new_cap + word_bits - 1) / word_bits) * word_bits;
+
+        bits_.resize(new_cap / word_bits, 0);
+        index_.resize(new_cap, 0);
+    }
+
+    std::vector<word_type> bits_;
+    std::vector<uint32_t> index_;
+    std::vector<int> list_;
+    mutable std::recursive_mutex lock_;
+};
+
 struct epoll {
 
-    using set_type = protected_set<int, mp::set<int>>;
+    using set_type = ready_set;
+    // sets which could contain also virtual (negative) sockets
+    using virt_set_type = protected_set<int, mp::flat_set<int>>;
     static constexpr int EPOLLER_MAX_EVENTS = 50;
 
     struct epoll_event events[EPOLLER_MAX_EVENTS];
     std::atomic_int epoll_fd_ = 0;
     std::atomic_int hint_fd_ = 0;
     bool auto_epollout_remove = true;
+
+    // edge-triggered mode: sockets are registered once with EPOLLIN|EPOLLOUT|EPOLLET and modify() of registered socket
+    // is a no-op. Readers and writers must drain socket until EAGAIN, or enforce_in() it if they stop earlier.
+    // Hint socket is always level-triggered. Opt-in, set before any socket is added.
+    static inline bool default_edge_triggered = false;
+    bool edge_triggered = false;
+    set_type et_registered;
     set_type in_set;
     set_type out_set;
     set_type err_set;
     set_type enforce_in_set;
 
-    // this set is used for sockets where ARE already some data, but we wait for more.
-    // because of this, socket will be REMOVED from in_set (so avoiding CPU spikes when there are still not enough of data)
-    // but those sockets will be added latest after time set in @rescan_timeout microseconds.
-    set_type rescan_set_in;
-    set_type rescan_set_out;
-    std::chrono::high_resolution_clock::time_point rescan_timer {};
+    // socket deadlines of this poller are kept in a single timer wheel. Expired timers are processed in wait(), its
+    // timeout is shortened to the nearest deadline.
+    //   IDLE_WATCH    - socket goes to idle_set if there is no activity for idle_timeout_ms (activity cancels it)
+    //   IDLE_DEADLINE - socket goes to idle_set at given time regardless of activity (owner re-arms it)
+    //   RESCAN_IN/OUT - socket was removed from epoll, because there ARE already some data, but we wait for more.
+    //                   This avoids CPU spikes when there are still not enough of data. Socket is added back after
+    //                   baseCom::rescan_msec milliseconds.
+    enum class timer_kind : uint8_t { IDLE_WATCH = 0, IDLE_DEADLINE, RESCAN_IN, RESCAN_OUT, MAX };
+    struct timer_key {
+        int socket = 0;
+        timer_kind kind = timer_kind::IDLE_WATCH;
+    };
+    using timer_wheel_type = timer_wheel<timer_key>;
 
     bool in_read_set(int check);
     bool in_write_set(int check);
@@ -143,20 +306,10 @@ struct epoll {
     // idle timeout
     int idle_timeout_ms = 1000;
 
-    // incremented each click and reset on trigger (if greater than idle_timeout_ms)
-    long idle_counter = 0;
-    // if round is 0, we are waiting. If 1 - we will trigger on watched sockets
-    // make it 1, so on start it will flip to 0
-    bool idle_round = true;
-
-    //sockets to be added to idle_watched (to ensure defined idle timeout (and possibly slightly more)
-    set_type idle_watched_pre;
-    //idle socket timer - sockets in this list will be added to idle_set.
-    // However, if we receive *any* socket activity (depends on monitoring), socket is
-    set_type idle_watched;
-
     // set with sockets in idle state. Idle list is erased on each poll.
     set_type idle_set;
+    // virtual sockets with expired idle deadline
+    virt_set_type idle_virt_set;
     bool in_idle_set(int check);
     bool in_idle_watched_set(int check);
 
@@ -164,14 +317,18 @@ struct epoll {
     unsigned long clear_idle_watch(int check);
     void set_idle_watch(int check);
 
+    /// @brief (re)arm one-shot deadline: socket (also virtual) will be put into idle set after 'timeout_ms'
+    void set_idle_deadline(int socket, long timeout_ms);
+    /// @brief cancel all timers of the socket
+    void cancel_timers(int socket);
 
-    int init();
+    /// @brief milliseconds to the nearest timer event, -1 if there is none
+    long next_timeout() const;
 
-    /// @brief prepare rescan sockets for another wait() operation
-    void process_pre_wait_rescans();
+    /// @brief fire expired timers, return number of them
+    std::size_t process_timers();
 
-    /// @brief prepare idle sockets for another wait() operation
-    void process_pre_wait_idles();
+    virtual int init();
 
     /// @brief wait on poll results from epoll_wait with 'timeout' passed to it: zero: return immediately, negative: block indefinitely
     virtual int wait(long timeout);
@@ -179,6 +336,9 @@ struct epoll {
     /// @brief add enforced sockets to in_set
     void enforced_to_inset();
 
+    /// @brief backend specific part of wait(): collect ready sockets into 'events' and process them, return their count
+    virtual int poll_events(long timeout);
+
     int process_epoll_events(int nfds);
     virtual bool add(int socket, int mask);
     virtual bool modify(int socket, int mask);
@@ -189,8 +349,9 @@ struct epoll {
     virtual unsigned long cancel_rescan_in(int socket);
     virtual unsigned long cancel_rescan_out(int socket);
     bool rescans_empty() const;
+    bool enforced_empty() const;
 
-    virtual bool click_timer_now (); // return true if we should add them back to in_set (scan their readability again). If yes, reset timer.
+    virtual bool click_timer_now (); // fire expired timers now, return true if any of them expired
 
     void clear();
 
@@ -206,6 +367,26 @@ struct epoll {
     logan_lite log = logan_lite("com.epoll");
 
     void _debug_sockets(int nfds); // debug print sockets in events
+
+protected:
+    int effective_mask(int socket, int mask) const;
+
+private:
+    using timer_handles = std::array<timer_wheel_type::handle_type, static_cast<std::size_t>(timer_kind::MAX)>;
+
+    // arm timer of given kind, unless it's already pending. Return true if armed.
+    bool arm_timer(int socket, timer_kind kind, long timeout_ms);
+    bool cancel_timer(int socket, timer_kind kind);
+    bool timer_pending(int socket, timer_kind kind) const;
+    timer_handles* handles_ul(int socket, bool create);
+
+    timer_wheel_type timers_;
+    std::vector<timer_handles> timer_handles_;               // indexed by socket
+    std::unordered_map<int, timer_handles> virt_timer_handles_;
+    std::vector<timer_key> timers_expired_;
+    std::atomic_uint rescans_armed_ = 0;
+    std::atomic_uint idle_watches_armed_ = 0;
+    mutable std::mutex timers_lock_;
 };
 
 
@@ -240,6 +421,11 @@ using handler_info_t = handler_info;
  * code. It's kind of wrapper, which doesn't init anything until there is an attempt to ADD something into it.
  */
 struct epoller {
+
+    // poller backend used for newly created pollers
+    enum class backend_t { EPOLL, URING };
+    static inline backend_t backend = backend_t::EPOLL;
+
     std::unique_ptr<epoll> poller;
     virtual void init_if_null();
     
@@ -256,6 +442,11 @@ struct epoller {
     unsigned long cancel_rescan_out(int socket);
 
     bool rescans_empty();
+    bool enforced_empty();
+
+    // switch poller to edge-triggered mode (see epoll::edge_triggered). Do it before any socket is added.
+    void edge_triggered(bool et);
+    bool edge_triggered() const;
 
     bool click_timer_now (); // return true if we should add them back to in_set (scan their readability again). If yes, reset timer.
     
@@ -263,13 +454,16 @@ struct epoller {
     bool hint_socket(int socket); // this is the socket which will be additionally monitored for EPOLLIN; each time it's readable, single byte is read from it.
 
     // handler hints is a map of socket->handler. We will allow to grow it as needed. No purges. 
-    mp::map<int,handler_info_t> handler_db;
+    mp::hash_map<int,handler_info_t> handler_db;
     epoll_handler* get_handler(int check);
     void clear_handler(int check);
     void set_handler(int check, epoll_handler*);
+    // unregister all sockets of the handler, so it can be registered with another poller
+    void release_handler(epoll_handler*);
 
     void set_idle_watch(int check);
     void clear_idle_watch(int check);
+    void set_idle_deadline(int check, long timeout_ms);
 
     ~epoller();
 
@@ -301,7 +495,7 @@ public:
 
 private:
     epoller* registrant = nullptr;
-    epoll::set_type registered_sockets;
+    epoll::virt_set_type registered_sockets;
     std::mutex lock_;
 };
 
@@ -37,6 +37,13 @@ public:
     ~lockbuffer() override = default;
     
     lockbuffer& operator= (const lockbuffer& x);
+
+    // socket buffers are consumed from the front repeatedly (partial writes, processed reads): advance instead of
+    // moving the remaining data, see buffer::consume(). flush(0) still empties the buffer.
+    void flush (size_type n) {
+        if(n == 0) clear();
+        else consume(n);
+    }
 };
 
 inline lockbuffer& lockbuffer::operator= (const lockbuffer& x)
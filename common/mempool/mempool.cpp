@@ -19,52 +19,262 @@
 #include <mempool/mempool.hpp>
 
 #include <unordered_map>
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <fstream>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
 #include "buffer.hpp"
 
 
-void memPool::Bucket::init_memory(std::size_t cnt) {
+namespace {
+    std::size_t page_size() {
+        static const auto ps = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        return ps;
+    }
+    uint8_t* page_down(uint8_t* p) { return reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(p) & ~(page_size() - 1)); }
+    uint8_t* page_up(uint8_t* p) { return page_down(p + page_size() - 1); }
+}
+
+void memPool::Bucket::init_memory(std::size_t cnt, uint8_t* region, std::size_t region_size,
+                                  std::size_t slab_bytes, std::size_t max_grow) {
     auto lc_ = std::scoped_lock(*this);
 
     count = cnt;
+    count_base = cnt;
     canary_sz = get_canary().canary_sz;
 
-    allocated = count * sz + count * canary_sz + canary_sz;
-    bigptr = static_cast<uint8_t*>(::malloc(allocated));
-    _endptr = bigptr + allocated;
+    stride = sz + canary_sz;
+    allocated = cnt * stride + canary_sz;
+
+    in_arena = region and allocated <= region_size
+               and ::mprotect(region, allocated, PROT_READ | PROT_WRITE) == 0;
+
+    bigptr = in_arena ? region : static_cast<uint8_t*>(::malloc(allocated));
+
+    // slabs are possible only in the reserved region, chunk indexes must fit into links
+    slab_chunks = 0;
+    slabs.clear();
+    if(in_arena and slab_bytes > 0) {
+        slab_chunks = std::max<std::size_t>(slab_bytes / stride, 1);
+        auto room = std::min(max_grow, region_size - allocated) / (slab_chunks * stride);
+        room = std::min(room, (nil - 1 - cnt) / slab_chunks);
+        slabs.assign(room, 0);
+    }
+    count_max = cnt + slabs.size() * slab_chunks;
+    _endptr = bigptr + count_max * stride + canary_sz;
+
+    // base chunks are not touched here, they are carved on first use and enter the freelist once released
+    carved.store(0);
+    free_head.store(make_head(0, nil));
+    free_count.store(0);
+}
+
+std::optional<uint32_t> memPool::Bucket::carve() {
+    auto n = carved.load(std::memory_order_relaxed);
+    while(n < count_base) {
+        if(carved.compare_exchange_weak(n, n + 1, std::memory_order_relaxed)) {
+            // canaries are shared with neighbours, writing the same bytes twice is harmless
+            auto* cur_ptr = chunk_ptr(n);
+            get_canary().write_canary(cur_ptr - canary_sz);
+            get_canary().write_canary(cur_ptr + sz);
+            return n;
+        }
+    }
+    return std::nullopt;
+}
+
+bool memPool::Bucket::grow() {
+    if(slabs.empty()) return false;
+
+    auto lc_ = std::scoped_lock(*this);
+    if(size() > 0) return true;
+
+    auto it = std::find(slabs.begin(), slabs.end(), 0);
+    if(it == slabs.end()) return false;
 
-    // now, stockpile
+    auto s = static_cast<std::size_t>(it - slabs.begin());
+    auto first = slab_first(s);
 
-    auto ptr = bigptr;
-    get_canary().write_canary(ptr);
-    for(unsigned char* cur_ptr = ptr + canary_sz; cur_ptr < ptr + allocated; cur_ptr += (sz + canary_sz)) {
-        bucket.template emplace(cur_ptr, sz);
+    // pages may be shared with neighbour slabs, they are committed already - no harm
+    auto* from = page_down(chunk_ptr(first));
+    auto* to = page_up(chunk_ptr(first + slab_chunks));
+    if(::mprotect(from, static_cast<std::size_t>(to - from), PROT_READ | PROT_WRITE) != 0) return false;
 
-        // write canary string at the end of data
+    get_canary().write_canary(chunk_ptr(first) - canary_sz);
+    for(std::size_t i = 0; i < slab_chunks; ++i) {
+        auto idx = static_cast<uint32_t>(first + i);
+        auto* cur_ptr = chunk_ptr(idx);
+        store_link(cur_ptr, i + 1 < slab_chunks ? idx + 1 : nil);
         get_canary().write_canary(cur_ptr + sz);
     }
+
+    *it = 1;
+    count.fetch_add(slab_chunks, std::memory_order_relaxed);
+    push_chain(first, chunk_ptr(static_cast<uint32_t>(first + slab_chunks - 1)), slab_chunks);
+
+    return true;
+}
+
+std::size_t memPool::Bucket::trim(std::size_t spare) {
+    if(slabs.empty()) return 0;
+
+    auto lc_ = std::scoped_lock(*this);
+    if(std::count(slabs.begin(), slabs.end(), 1) <= static_cast<long>(spare)) return 0;
+
+    // detach the whole free list, nobody else can touch these chunks now
+    auto head = free_head.load(std::memory_order_acquire);
+    while(not free_head.compare_exchange_weak(head, make_head(static_cast<uint32_t>(head >> 32) + 1, nil),
+                                              std::memory_order_acq_rel, std::memory_order_acquire)) {}
+
+    auto const top = static_cast<uint32_t>(head & 0xffffffff);
+    auto slab_of = [this](uint32_t idx) { return (idx - count_base) / slab_chunks; };
+
+    std::vector<std::size_t> free_in(slabs.size(), 0);
+    std::size_t detached = 0;
+    for(auto idx = top; idx != nil; idx = load_link(chunk_ptr(idx))) {
+        ++detached;
+        if(idx >= count_base) ++free_in[slab_of(idx)];
+    }
+    free_count.fetch_sub(detached, std::memory_order_relaxed);
+
+    // release higher slabs first, lower addresses stay warm
+    std::size_t kept = 0;
+    std::vector<std::size_t> released;
+    for(auto s = slabs.size(); s-- > 0; ) {
+        if(not slabs[s] or free_in[s] != slab_chunks) continue;
+        if(kept < spare) {
+            ++kept;
+            continue;
+        }
+        slabs[s] = 0;
+        released.push_back(s);
+    }
+
+    // put surviving chunks back, in the original order
+    uint32_t first = nil;
+    uint8_t* last = nullptr;
+    std::size_t linked = 0;
+    for(auto idx = top; idx != nil; ) {
+        auto* cur_ptr = chunk_ptr(idx);
+        auto next = load_link(cur_ptr);
+
+        if(idx < count_base or slabs[slab_of(idx)]) {
+            if(last) store_link(last, idx);
+            else first = idx;
+            last = cur_ptr;
+            ++linked;
+        }
+        idx = next;
+    }
+    if(linked > 0) push_chain(first, last, linked);
+
+    // drop pages fully inside released slabs, canaries around them stay intact. Memory stays mapped, so
+    // stale readers racing on freelist links read zeroes instead of faulting.
+    for(auto s: released) {
+        auto* from = page_up(chunk_ptr(slab_first(s)));
+        auto* to = page_down(chunk_ptr(static_cast<uint32_t>(slab_first(s) + slab_chunks)) - canary_sz);
+        if(to > from) ::madvise(from, static_cast<std::size_t>(to - from), MADV_DONTNEED);
+        count.fetch_sub(slab_chunks, std::memory_order_relaxed);
+    }
+
+    return released.size();
+}
+
+uint32_t memPool::Bucket::load_link(uint8_t const* chunk) noexcept {
+    // chunk may be concurrently acquired and written by its new owner, stale value is then rejected by CAS
+    return __atomic_load_n(reinterpret_cast<uint32_t const*>(chunk), __ATOMIC_RELAXED);
+}
+
+void memPool::Bucket::store_link(uint8_t* chunk, uint32_t next) noexcept {
+    __atomic_store_n(reinterpret_cast<uint32_t*>(chunk), next, __ATOMIC_RELAXED);
+}
+
+std::optional<uint32_t> memPool::Bucket::chunk_index(uint8_t const* ptr) const noexcept {
+    if(not is_mine(ptr) or ptr < bigptr + canary_sz) return std::nullopt;
+
+    auto off = static_cast<std::size_t>(ptr - (bigptr + canary_sz));
+    if(off % stride != 0) return std::nullopt;
+
+    auto idx = off / stride;
+    if(idx >= count_max) return std::nullopt;
+
+    return static_cast<uint32_t>(idx);
+}
+
+void memPool::Bucket::push_chain(uint32_t first, uint8_t* last, std::size_t n) {
+    auto head = free_head.load(std::memory_order_relaxed);
+    do {
+        store_link(last, static_cast<uint32_t>(head & 0xffffffff));
+    } while(not free_head.compare_exchange_weak(head, make_head(static_cast<uint32_t>(head >> 32) + 1, first),
+                                                std::memory_order_release, std::memory_order_relaxed));
+
+    free_count.fetch_add(n, std::memory_order_relaxed);
+}
+
+std::optional<uint32_t> memPool::Bucket::pop() {
+    auto head = free_head.load(std::memory_order_acquire);
+    while(true) {
+        auto idx = static_cast<uint32_t>(head & 0xffffffff);
+        if(idx == nil) return carve();
+
+        auto next = load_link(chunk_ptr(idx));
+        if(free_head.compare_exchange_weak(head, make_head(static_cast<uint32_t>(head >> 32) + 1, next),
+                                           std::memory_order_acq_rel, std::memory_order_acquire)) {
+            free_count.fetch_sub(1, std::memory_order_relaxed);
+            return idx;
+        }
+    }
 }
 
 std::size_t memPool::Bucket::size() const {
-    auto lc_ = std::shared_lock(*this);
-    return bucket.size();
+    return free_count.load(std::memory_order_relaxed) + (count_base - carved.load(std::memory_order_relaxed));
 }
 
 void memPool::Bucket::release(mem_chunk mch) {
-    if(is_mine(mch.ptr)) {
-        mch.in_pool = true;
+    if(auto idx = chunk_index(mch.ptr); idx) {
+        push_chain(idx.value(), mch.ptr, 1);
+    }
+}
 
-        auto lc_ = std::scoped_lock(*this);
-        bucket.push(mch);
+std::size_t memPool::Bucket::acquire_batch(uint8_t** out, std::size_t n) {
+    std::size_t i = 0;
+    for(; i < n; ++i) {
+        auto idx = pop();
+        if(not idx) break;
+
+        out[i] = chunk_ptr(idx.value());
     }
+    return i;
 }
 
-std::optional<mem_chunk> memPool::Bucket::acquire() {
-    auto lc_ = std::scoped_lock(*this);
+void memPool::Bucket::release_batch(uint8_t* const* ptrs, std::size_t n) {
 
-    if(not bucket.empty()) {
-        auto mem = bucket.top();
-        bucket.pop();
-        return mem;
+    // link batch locally, then publish it with single CAS
+    uint8_t* last = nullptr;
+    uint32_t first = nil;
+    std::size_t linked = 0;
+
+    for(std::size_t i = 0; i < n; ++i) {
+        auto idx = chunk_index(ptrs[i]);
+        if(not idx) continue;
+
+        if(last) store_link(last, idx.value());
+        else first = idx.value();
+
+        last = ptrs[i];
+        ++linked;
+    }
+
+    if(linked > 0) push_chain(first, last, linked);
+}
+
+std::optional<mem_chunk> memPool::Bucket::acquire() {
+    if(auto idx = pop(); idx) {
+        return mem_chunk(chunk_ptr(idx.value()), sz);
     }
     return std::nullopt;
 }
@@ -81,7 +291,7 @@ bool memPool::Bucket::is_aligned(uint8_t const* ptr) const noexcept {
 
 
 
-memPool::memPool(std::size_t sz256, std::size_t sz1k, std::size_t sz5k, std::size_t sz10k, std::size_t sz20k) {
+memPool::memPool(int node) : node_(node) {
 
 #ifndef MEMPOOL_DISABLE
 
@@ -89,8 +299,7 @@ memPool::memPool(std::size_t sz256, std::size_t sz1k, std::size_t sz5k, std::siz
 
         auto ptr_str_size = std::getenv("SX_MEMSIZE");
 
-        // size is mentioned as percent of default values, which are:
-        // 5000,10000,10000,1000,800
+        // size is mentioned as percent of default chunk counts
         int size = 100;
 
         if (ptr_str_size) {
@@ -108,64 +317,424 @@ memPool::memPool(std::size_t sz256, std::size_t sz1k, std::size_t sz5k, std::siz
         return size;
     };
 
+    auto get_env_table = []() -> size_table {
+
+        if(auto ptr_str_table = std::getenv("SX_MEMCLASSES"); ptr_str_table) {
+            auto table = parse_size_table(ptr_str_table);
+            if(not table.empty()) return table;
+
+            std::cerr << "SX_MEMCLASSES: expecting size:count,size:count,..." << std::endl;
+        }
+
+        return size_table_override.empty() ? default_size_table() : size_table_override;
+    };
+
     auto size = get_env_size();
-    allocate(sz256*size, sz1k*size, sz5k*size, sz10k*size, sz20k*size);
+    allocate(get_env_table(), size);
 #endif
 
     is_ready() = true; // mark memPool ready for use
 }
 
 
-void memPool::allocate(std::size_t n_sz256, std::size_t n_sz1k, std::size_t n_sz5k,
-                     std::size_t n_sz10k, std::size_t n_sz20k) {
+void memPool::allocate(size_table const& table, std::size_t percent) {
 
 #ifdef MEMPOOL_DISABLE
     return;
 #endif
 
-    sz32  = n_sz256 * m32;
-    sz64  = n_sz256 * m64;
-    sz128 = n_sz256 * m128;
-    sz256 = n_sz256;
-    sz1k  = n_sz1k;
-    sz5k  = n_sz5k;
-    sz10k = n_sz10k;
-    sz20k = n_sz20k;
-    sz35k = n_sz20k;
-    sz50k = n_sz20k;
-
 #ifdef MEMPOOL_DEBUG
     get_canary().canary_sz = 8; // add 8 bytes of canary
 #else
     get_canary().canary_sz = 0;
 #endif
 
-    bucket_32.init_memory(sz32);
-    bucket_64.init_memory(sz64);
-    bucket_128.init_memory(sz128);
-    bucket_256.init_memory(sz256);
-    bucket_1k.init_memory(sz1k);
-    bucket_5k.init_memory(sz5k);
-    bucket_10k.init_memory(sz10k);
-    bucket_20k.init_memory(sz20k);
-    bucket_35k.init_memory(sz35k);
-    bucket_50k.init_memory(sz50k);
-
-    buckets.emplace(&bucket_32);
-    buckets.emplace(&bucket_64);
-    buckets.emplace(&bucket_128);
-    buckets.emplace(&bucket_256);
-    buckets.emplace(&bucket_1k);
-    buckets.emplace(&bucket_5k);
-    buckets.emplace(&bucket_10k);
-    buckets.emplace(&bucket_20k);
-    buckets.emplace(&bucket_35k);
-    buckets.emplace(&bucket_50k);
+    table_ = normalize_size_table(table);
+
+    // address space the biggest bucket may ever use
+    std::size_t region_need = 0;
+    for(auto const& cl: table_) {
+        auto const stride = cl.size + get_canary().canary_sz;
+        auto need = cl.count * percent * stride + get_canary().canary_sz;
+        if(elastic_enabled) need += elastic_max_bytes;
+        region_need = std::max(region_need, need);
+    }
+
+    arena_reserve(region_need);
+    arena_only_ = (arena_ != nullptr);
+
+    classes_count_ = 0;
+    for(auto const& cl: table_) {
+        auto idx = classes_count_++;
+
+        auto& b = classes_[idx];
+        b = std::make_unique<Bucket>(cl.size);
+        b->index = idx;
+        class_size_[idx] = cl.size;
+
+        uint8_t* region = arena_ ? arena_ + (b->index << arena_region_shift_) : nullptr;
+        auto const region_size = arena_ ? std::size_t{1} << arena_region_shift_ : 0;
+
+        if(region and elastic_thp) {
+            // advisory only, kernel may not support it
+            ::madvise(region, region_size, MADV_HUGEPAGE);
+        }
+        b->init_memory(cl.count * percent, region, region_size,
+                       elastic_enabled ? elastic_slab_bytes : 0, elastic_enabled ? elastic_max_bytes : 0);
+
+        if(b->in_arena) arena_owner_[b->index] = b.get();
+        else arena_only_ = false;
+
+        tcache_setup(*b);
+        buckets.emplace(b.get());
+    }
+}
+
+auto memPool::default_size_table() -> size_table const& {
+    static const size_table t = {
+            {32, 1600}, {64, 800}, {128, 400}, {256, 100},
+            {1024, 50}, {5L*1024, 50}, {10L*1024, 10},
+            {20L*1024, 8}, {35L*1024, 8}, {50L*1024, 8} };
+    return t;
+}
+
+auto memPool::normalize_size_table(size_table table) -> size_table {
+
+    for(auto& cl: table) {
+        cl.size = (cl.size + 15) & ~std::size_t{15};
+    }
+    table.erase(std::remove_if(table.begin(), table.end(), [](auto const& cl) { return cl.size == 0 or cl.count == 0; }),
+                table.end());
+    std::sort(table.begin(), table.end(), [](auto const& a, auto const& b) { return a.size < b.size; });
+
+    size_table ret;
+    for(auto const& cl: table) {
+        if(not ret.empty() and ret.back().size == cl.size) ret.back().count += cl.count;
+        else ret.push_back(cl);
+    }
+
+    // keep the largest classes, smaller requests still fit into them
+    if(ret.size() > max_buckets) ret.erase(ret.begin(), ret.begin() + static_cast<long>(ret.size() - max_buckets));
+
+    return ret;
+}
+
+auto memPool::parse_size_table(std::string const& str) -> size_table {
+    size_table ret;
+
+    for(auto const& item: string_split(str, ',')) {
+        auto parts = string_split(item, ':');
+        if(parts.size() != 2) return {};
+
+        auto s = safe_val(parts[0]);
+        auto c = safe_val(parts[1]);
+        if(s <= 0 or c <= 0) return {};
+
+        ret.push_back({ static_cast<std::size_t>(s), static_cast<std::size_t>(c) });
+    }
+
+    return ret;
+}
+
+std::string memPool::size_table_str(size_table const& table) {
+    std::stringstream ss;
+    for(auto const& cl: table) {
+        if(ss.tellp() > 0) ss << ',';
+        ss << cl.size << ':' << cl.count;
+    }
+    return ss.str();
+}
+
+std::size_t memPool::size_histogram::bin_of(std::size_t s) {
+    if(s == 0) return 0;
+    if(s <= 64) return (s - 1) / 16;
+
+    auto const p = static_cast<std::size_t>(63 - __builtin_clzll(s - 1));
+    if(p > 20) return bins - 1;
+
+    auto const sub = ((s - 1) >> (p - 2)) & 3;
+    return 4 + (p - 6) * 4 + sub;
+}
+
+std::size_t memPool::size_histogram::bin_upper(std::size_t b) {
+    if(b < 4) return (b + 1) * 16;
+    if(b >= bins - 1) return 0;
+
+    auto const q = b - 4;
+    auto const p = q / 4 + 6;
+    return (4 + q % 4 + 1) << (p - 2);
+}
+
+auto memPool::suggest_size_table(std::size_t classes) const -> size_table {
+
+    // observed bins; request sizes are approximated by bin upper bounds
+    std::vector<std::pair<std::size_t, unsigned long long>> seen;
+    for(std::size_t b = 0; b + 1 < size_histogram::bins; ++b) {
+        if(auto h = size_profile.hits[b].load(std::memory_order_relaxed); h > 0) seen.emplace_back(size_histogram::bin_upper(b), h);
+    }
+    classes = std::min({ classes, max_buckets, seen.size() });
+    if(classes == 0) return {};
+
+    auto const n = seen.size();
+
+    // waste of serving bins i..j by the class of size seen[j]
+    auto waste = [&seen](std::size_t i, std::size_t j) {
+        unsigned long long w = 0;
+        for(auto k = i; k <= j; ++k) w += seen[k].second * (seen[j].first - seen[k].first);
+        return w;
+    };
+
+    // best[c][j]: least waste covering bins 0..j with c+1 classes, the largest one at j
+    constexpr auto inf = std::numeric_limits<unsigned long long>::max();
+    std::vector<std::vector<unsigned long long>> best(classes, std::vector<unsigned long long>(n, inf));
+    std::vector<std::vector<std::size_t>> from(classes, std::vector<std::size_t>(n, 0));
+
+    for(std::size_t j = 0; j < n; ++j) best[0][j] = waste(0, j);
+    for(std::size_t c = 1; c < classes; ++c) {
+        for(std::size_t j = c; j < n; ++j) {
+            for(std::size_t i = c - 1; i < j; ++i) {
+                if(best[c - 1][i] == inf) continue;
+
+                auto w = best[c - 1][i] + waste(i + 1, j);
+                if(w < best[c][j]) {
+                    best[c][j] = w;
+                    from[c][j] = i;
+                }
+            }
+        }
+    }
+
+    // walk back from the largest bin, which must be covered
+    std::vector<std::size_t> picked;
+    auto c = classes - 1;
+    for(auto j = n - 1; ; --c) {
+        picked.push_back(j);
+        if(c == 0) break;
+        j = from[c][j];
+    }
+    std::reverse(picked.begin(), picked.end());
+
+    // split bytes of the current table by the share of requested bytes
+    std::size_t table_bytes = 0;
+    for(auto const& cl: table_) table_bytes += cl.size * cl.count;
+    if(table_bytes == 0) for(auto const& cl: default_size_table()) table_bytes += cl.size * cl.count;
+
+    std::vector<unsigned long long> class_bytes;
+    unsigned long long total_bytes = 0;
+    std::size_t lo = 0;
+    for(auto j: picked) {
+        unsigned long long cb = 0;
+        for(auto k = lo; k <= j; ++k) cb += seen[k].second * seen[j].first;
+        class_bytes.push_back(cb);
+        total_bytes += cb;
+        lo = j + 1;
+    }
+
+    size_table ret;
+    for(std::size_t k = 0; k < picked.size(); ++k) {
+        auto const sz = seen[picked[k]].first;
+        auto const share = static_cast<double>(class_bytes[k]) / static_cast<double>(total_bytes);
+        ret.push_back({ sz, std::max<std::size_t>(1, static_cast<std::size_t>(share * static_cast<double>(table_bytes)) / sz) });
+    }
+
+    return ret;
+}
+
+namespace {
+    // thread cache object is gone (thread is exiting), don't touch it anymore
+    thread_local bool tcache_gone = false;
+}
+
+struct memPool::thread_cache {
+    struct magazine {
+        Bucket* bucket = nullptr;
+        std::size_t count = 0;
+        std::array<uint8_t*, tcache_slots> items {};
+    };
+    std::array<magazine, max_buckets> mags {};
+
+    void flush() {
+        for(auto& m: mags) {
+            if(m.bucket and m.count > 0) {
+                m.bucket->release_batch(m.items.data(), m.count);
+                m.count = 0;
+            }
+        }
+    }
+
+    ~thread_cache() {
+        tcache_gone = true;
+        if(not bailing) flush();
+    }
+};
+
+memPool::thread_cache* memPool::tcache() {
+    if(tcache_gone) return nullptr;
+
+    static thread_local thread_cache tc;
+    return &tc;
+}
+
+void memPool::tcache_flush() {
+    if(auto* tc = tcache(); tc) tc->flush();
+}
+
+void memPool::tcache_setup(Bucket& b) {
+    if(not tcache_enabled or b.index >= max_buckets) {
+        b.tcache_limit = 0;
+        return;
+    }
+
+    auto limit = std::min({ tcache_bytes / b.sz, b.count_base / std::max<std::size_t>(tcache_share, 1), tcache_slots });
+
+    // caching a single chunk is not worth it
+    b.tcache_limit = limit >= 2 ? limit : 0;
+}
+
+std::optional<mem_chunk> memPool::tcache_acquire(Bucket* b) {
+    if(b->tcache_limit == 0) return b->acquire();
+
+    auto* tc = tcache();
+    if(not tc) return b->acquire();
 
+    auto& m = tc->mags[b->index];
+    if(m.bucket != b) {
+        // thread switched pools, give chunks back to the old one
+        if(m.bucket and m.count > 0) m.bucket->release_batch(m.items.data(), m.count);
+        m.count = 0;
+        m.bucket = b;
+    }
+
+    if(m.count == 0) {
+        m.count = b->acquire_batch(m.items.data(), std::max<std::size_t>(b->tcache_limit / 2, 1));
+        stats.tcache_refill++;
+
+        if(m.count == 0) return std::nullopt;
+    }
+
+    return mem_chunk(m.items[--m.count], b->sz);
+}
+
+bool memPool::tcache_release(Bucket* b, unsigned char* ptr) {
+    if(b->tcache_limit == 0 or not b->is_mine(ptr)) return false;
+
+    auto* tc = tcache();
+    if(not tc) return false;
+
+    auto& m = tc->mags[b->index];
+    if(m.bucket != b) {
+        if(m.count > 0) return false;
+        m.bucket = b;
+    }
+
+    if(m.count >= b->tcache_limit) {
+        // flush the oldest half, keep recently used (cache-warm) chunks
+        auto half = m.count / 2;
+        b->release_batch(m.items.data(), half);
+        std::copy(m.items.begin() + static_cast<long>(half), m.items.begin() + static_cast<long>(m.count), m.items.begin());
+        m.count -= half;
+        stats.tcache_flush++;
+    }
+
+    m.items[m.count++] = ptr;
+    return true;
+}
+
+void memPool::arena_reserve(std::size_t region_size) {
+    if(arena_ or table_.empty()) return;
+
+    // at least a huge page per bucket
+    unsigned int shift = 21;
+    while((std::size_t{1} << shift) < region_size) ++shift;
+    auto const bytes = table_.size() << shift;
+
+    // address space only, memory is committed by buckets (mprotect) and faulted in on use
+    auto* p = ::mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(p == MAP_FAILED) {
+        // buckets will use malloc, and lookups fall back to the search
+        return;
+    }
+    arena_ = static_cast<uint8_t*>(p);
+    arena_region_shift_ = shift;
+    arena_bytes_ = bytes;
+
+    if(node_ >= 0) {
+        // pages are not faulted in yet, the policy applies to all of them. Preferred (not strict) binding
+        // doesn't kill us if the node runs out of memory.
+        unsigned long mask = 1UL << node_;
+        ::syscall(SYS_mbind, arena_, arena_bytes_, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+    }
+}
+
+std::size_t memPool::node_count() {
+    static const std::size_t count = []() -> std::size_t {
+        // "0-1", "0,2" or similar, highest node number is at the end
+        std::ifstream f("/sys/devices/system/node/online");
+        std::string line;
+        if(not std::getline(f, line) or line.empty()) return 1;
+
+        auto pos = line.find_last_of(",-");
+        auto last = safe_val(pos == std::string::npos ? line : line.substr(pos + 1));
+        return last >= 0 ? std::min(static_cast<std::size_t>(last) + 1, max_nodes) : 1;
+    }();
+    return count;
+}
+
+std::array<std::atomic<memPool*>, memPool::max_nodes>& memPool::nodes() {
+    static std::array<std::atomic<memPool*>, max_nodes> n {};
+    return n;
+}
+
+memPool& memPool::node_pool(std::size_t node) {
+    if(node == 0 or node >= max_nodes) {
+        static auto m = memPool(numa_enabled and node_count() > 1 ? 0 : -1);
+        nodes()[0].store(&m, std::memory_order_release);
+        return m;
+    }
+
+    if(auto* p = nodes()[node].load(std::memory_order_acquire); p) return *p;
+
+    static std::mutex create_lock;
+    auto l_ = std::scoped_lock(create_lock);
+    if(auto* p = nodes()[node].load(std::memory_order_acquire); p) return *p;
+
+    // node pools live until the very end, chunks may be released late during exit
+    auto* p = new memPool(static_cast<int>(node));
+    nodes()[node].store(p, std::memory_order_release);
+    return *p;
+}
+
+memPool& memPool::local_pool() {
+    if(numa_enabled and node_count() > 1) {
+        unsigned int cpu = 0;
+        unsigned int node = 0;
+        if(::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return node_pool(node);
+    }
+    return node_pool(0);
 }
 
 auto memPool::find_by_address(void* ptr) -> Bucket* {
 
+    if(arena_contains(ptr)) return find_local(ptr);
+
+    // chunk of other node's pool
+    for(auto& n: nodes()) {
+        auto* other = n.load(std::memory_order_acquire);
+        if(other and other != this and other->arena_contains(ptr)) return other->find_local(ptr);
+    }
+
+    return arena_only_ ? nullptr : find_local(ptr);
+}
+
+auto memPool::find_local(void* ptr) -> Bucket* {
+
+    auto const* p = static_cast<uint8_t const*>(ptr);
+    if(arena_contains(ptr)) {
+        auto* b = arena_owner_[static_cast<std::size_t>(p - arena_) >> arena_region_shift_];
+        return (b and b->is_mine(p)) ? b : nullptr;
+    }
+    if(arena_only_) return nullptr;
+
     auto it = std::find_if(buckets.begin(), buckets.end(), [&ptr](auto const* x) { return x->is_mine((uint8_t*) ptr); });
     if(it != buckets.end()) return *it;
 
@@ -175,16 +744,16 @@ auto memPool::find_by_address(void* ptr) -> Bucket* {
 
 std::size_t memPool::find_ptr_size(void* ptr) {
 
-    auto it = std::find_if(buckets.begin(), buckets.end(), [&ptr](auto const* x) { return x->is_mine((uint8_t*) ptr); });
-    if(it != buckets.end()) return (*it)->sz;
-
-    return 0;
+    auto* b = find_by_address(ptr);
+    return b ? b->sz : 0;
 }
 
-mem_chunk_t memPool::acquire(std::size_t sz) {
+mem_chunk_t memPool::acquire_chunk(std::size_t sz) {
 
     if(sz == 0) return mem_chunk_t(nullptr, 0);
 
+    if(profile_sizes) size_profile.record(sz);
+
     auto* mem_bucket = pick_bucket(sz);
 
     // mempool is not available, or is empty, use heap
@@ -203,7 +772,12 @@ mem_chunk_t memPool::acquire(std::size_t sz) {
 
     } else {
 
-        auto free_entry = mem_bucket->acquire();
+        auto free_entry = tcache_acquire(mem_bucket);
+        if(not free_entry and mem_bucket->grow()) {
+            stats.elastic_grow++;
+            free_entry = tcache_acquire(mem_bucket);
+        }
+
         if(free_entry) {
 
             free_entry->in_pool = false;
@@ -233,7 +807,7 @@ mem_chunk_t memPool::acquire(std::size_t sz) {
 }
 
 
-void memPool::release(mem_chunk_t to_ret){
+void memPool::release_chunk(mem_chunk_t to_ret){
 
     if (not to_ret.ptr) {
 
@@ -267,10 +841,21 @@ void memPool::release(mem_chunk_t to_ret){
         return;
     }
     else {
-        stats.ret++;
+        auto const nret = ++stats.ret;
         stats.ret_size += mem_pool->chunk_size();
 
-        mem_pool->release(to_ret);
+        if(not is_local(mem_pool)) {
+            // goes straight to the owner, thread cache holds only chunks of the thread's pool
+            stats.remote_free++;
+            mem_pool->release(to_ret);
+        }
+        else if(not tcache_release(mem_pool, to_ret.ptr)) {
+            mem_pool->release(to_ret);
+        }
+
+        if(elastic_trim_sec > 0 and elastic_trim_every > 0 and nret % elastic_trim_every == 0) {
+            trim_maybe();
+        }
 
         #ifdef MEMPOOL_DEBUG
         std::lock_guard<std::mutex> l(mpdata::trace_lock());
@@ -303,24 +888,41 @@ void memPool::release(mem_chunk_t to_ret){
     }
 }
 
+std::size_t memPool::trim() {
+    std::size_t ret = 0;
+    for(auto* b: buckets) {
+        ret += b->trim(elastic_spare_slabs);
+    }
+    stats.elastic_trim += ret;
+    return ret;
+}
+
+void memPool::trim_maybe() {
+    using namespace std::chrono;
+    auto const now = duration_cast<seconds>(steady_clock::now().time_since_epoch()).count();
+
+    auto last = trim_last_.load(std::memory_order_relaxed);
+    if(now - last < elastic_trim_sec) return;
+
+    // only one thread does the job
+    if(trim_last_.compare_exchange_strong(last, now)) {
+        trim();
+    }
+}
+
 std::optional<mem_chunk> memPool::tryhard_available(size_t s) {
 
     unsigned short overkill_level = 1;
 
-    for(auto& buck: buckets) {
+    for(std::size_t i = 0; i < classes_count_; ++i) {
+        auto* buck = classes_[i].get();
+        if(buck->chunk_size() < s) continue;
 
         // don't allow ridiculously large over-allocations
         if(overkill_level > 3) { break; }
 
-        if(buck->chunk_size() >= s) {
-
-            auto lc_ = std::scoped_lock(*buck);
-
-            if(not buck->bucket.empty()) {
-                auto mem = buck->bucket.top();
-                buck->bucket.pop();
-                return mem;
-            }
+        if(auto mem = buck->acquire(); mem) {
+            return mem;
         }
         ++overkill_level;
     }
@@ -371,26 +973,13 @@ auto memPool::pick_bucket(size_t s) -> Bucket* {
     return nullptr;
 #endif
 
-    if      (s > 50L * 1024) return nullptr;
-    else if (s <= 32L) return &bucket_32;
-    else {
-        if (s <= 1024) {
-            if (s >       256) return &bucket_1k;
-            else if (s >       128) return &bucket_256;
-            else if (s >       64) return &bucket_128;
-            else if (s >       32) return &bucket_64;
-        }
-        else {
-            if (s > 35L * 1024) return &bucket_50k;
-            else if (s > 20L * 1024) return &bucket_35k;
-            else if (s > 10L * 1024) return &bucket_20k;
-            else if (s >  5L * 1024) return &bucket_10k;
-            else if (s >  1L * 1024) return &bucket_5k;
-        }
-    }
+    if(classes_count_ == 0 or s > class_size_[classes_count_ - 1]) return nullptr;
 
-    return nullptr;
+    auto const* first = class_size_.data();
+    auto const* it = std::lower_bound(first, first + classes_count_, s);
+    return classes_[static_cast<std::size_t>(it - first)].get();
 }
+
 void* mempool_alloc(size_t s) {
 
 #ifdef MEMPOOL_ALL
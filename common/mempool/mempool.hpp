@@ -20,8 +20,10 @@
 #define MEMPOOL_HPP
 
 #include <cstddef>
+#include <array>
 #include <vector>
-#include <stack>
+#include <memory>
+#include <string>
 #include <mutex>
 #include <unordered_map>
 #include <atomic>
@@ -34,6 +36,7 @@
 
 #include <mempool/canary.hpp>
 #include <mempool/malloc_allocator.hpp>
+#include <mempool/sampler.hpp>
 
 
 //#define MEMPOOL_DEBUG
@@ -135,21 +138,38 @@ struct mem_chunk
 using mem_chunk_t = mem_chunk;
 
 class memPool {
+public:
+    // size classes: chunk size and number of chunks per one percent of SX_MEMSIZE
+    struct size_class {
+        std::size_t size = 0;
+        std::size_t count = 0;
+    };
+    using size_table = std::vector<size_class>;
+
+    /// table used unless SX_MEMCLASSES or size_table_override is set
+    static size_table const& default_size_table();
+
+    /// parse "size:count,size:count,..." (SX_MEMCLASSES format). @return empty table on error
+    static size_table parse_size_table(std::string const& str);
+    static std::string size_table_str(size_table const& table);
+
+    /// round sizes to 16B alignment, sort, merge duplicates and cut to the maximum number of buckets
+    static size_table normalize_size_table(size_table table);
+
+    // request size histogram: 16B steps up to 64B, then 4 steps per power of two, last bin is for sizes over 2MB
+    struct size_histogram {
+        constexpr static std::size_t bins = 65;
 
-    std::size_t sz32  = 0L;
-    constexpr static unsigned int m32 = 16;
-    std::size_t sz64  = 0L;
-    constexpr static unsigned int m64 = 8;
-    std::size_t sz128 = 0L;
-    constexpr static unsigned int m128 = 4;
-    std::size_t sz256 = 0L;
-    std::size_t sz1k  = 0L;
-    std::size_t sz5k  = 0L;
-    std::size_t sz10k = 0L;
-    std::size_t sz20k = 0L;
-    std::size_t sz35k = 0L;
-    std::size_t sz50k = 0L;
+        static std::size_t bin_of(std::size_t s);
+        static std::size_t bin_upper(std::size_t b);
 
+        void record(std::size_t s) { hits[bin_of(s)].fetch_add(1, std::memory_order_relaxed); }
+        void reset() { for(auto& h: hits) h.store(0, std::memory_order_relaxed); }
+
+        std::array<std::atomic<unsigned long long>, bins> hits {};
+    };
+
+private:
     class Bucket : public lockable {
     public:
         Bucket() = delete;
@@ -157,7 +177,8 @@ class memPool {
 
         ~Bucket() override {
             auto lc_ = std::scoped_lock(*this);
-            ::free(bigptr);
+            // arena memory is never unmapped, late releases may still arrive during exit
+            if(not in_arena) ::free(bigptr);
         }
 
         /// @return get available chunks in the bucket
@@ -176,27 +197,93 @@ class memPool {
         bool is_aligned(uint8_t const* ptr) const noexcept;
 
         /// @return of total number elements in the bucket (if none is acquired)
-        std::size_t total_count() const noexcept { return count; }
+        std::size_t total_count() const noexcept { return count.load(std::memory_order_relaxed); }
+
+        /// @return number of chunks the bucket starts with and never gives back
+        std::size_t base_count() const noexcept { return count_base; }
+
+        /// @return number of base chunks handed out at least once
+        std::size_t carved_count() const noexcept { return carved.load(std::memory_order_relaxed); }
 
         /// @return size of the single chunk
         std::size_t chunk_size() const noexcept { return sz; }
 
+        /// take up to @param n chunk pointers into @param out under single lock. @return number of chunks taken
+        std::size_t acquire_batch(uint8_t** out, std::size_t n);
+
+        /// return @param n chunk pointers under single lock
+        void release_batch(uint8_t* const* ptrs, std::size_t n);
+
+        /// add one slab of chunks if the bucket is empty. @return true if chunks are (or meanwhile became) available
+        bool grow();
+
+        /// give memory of completely free slabs back to the system, keeping @param spare free slabs.
+        /// @return number of slabs released
+        std::size_t trim(std::size_t spare);
+
     private:
         uint64_t ptr_address() const { return reinterpret_cast<uint64_t>(bigptr); }
-        void init_memory(std::size_t cnt);
+
+        /// carve chunks in @param region (reserved address range of @param region_size), or malloc if it's null or small.
+        /// Bucket in a region may grow by @param slab_bytes slabs up to @param max_grow bytes.
+        void init_memory(std::size_t cnt, uint8_t* region = nullptr, std::size_t region_size = 0,
+                         std::size_t slab_bytes = 0, std::size_t max_grow = 0);
+
+        // Free chunks form intrusive lock-free stack: first 4 bytes of a free chunk hold index of the next one.
+        // Head is [ 63-32: tag | 31-0: index ], tag changes on every update, which makes it ABA-safe.
+        constexpr static uint32_t nil = 0xffffffff;
+        static uint64_t make_head(uint32_t tag, uint32_t idx) { return (static_cast<uint64_t>(tag) << 32) | idx; }
+
+        uint8_t* chunk_ptr(uint32_t idx) const noexcept { return bigptr + canary_sz + idx * stride; }
+        std::optional<uint32_t> chunk_index(uint8_t const* ptr) const noexcept;
+        static uint32_t load_link(uint8_t const* chunk) noexcept;
+        static void store_link(uint8_t* chunk, uint32_t next) noexcept;
+
+        // push chain first..last (already linked together) of n chunks
+        void push_chain(uint32_t first, uint8_t* last, std::size_t n);
+        // freelist first (recently used chunks are warm), then carve
+        std::optional<uint32_t> pop();
+
+        // base chunks below 'carved' were handed out at least once, the rest was never touched
+        std::atomic<uint32_t> carved {0};
+        std::optional<uint32_t> carve();
 
         std::size_t sz = 0L;
-        std::stack<mem_chunk_t> bucket;
+        std::size_t stride = 0L;
+        std::atomic<uint64_t> free_head {make_head(0, nil)};
+        std::atomic<std::size_t> free_count {0};
 
         std::size_t allocated = 0;
         uint8_t* bigptr = nullptr;
-        uint8_t* _endptr = nullptr;
-        std::size_t count;
+        uint8_t* _endptr = nullptr;         // end of the reach, including slabs not grown (yet)
+        std::atomic<std::size_t> count {0};
+        std::size_t count_base = 0;
+        std::size_t count_max = 0;
         std::size_t canary_sz;
+        bool in_arena = false;
+
+        // Elastic part: slabs of 'slab_chunks' chunks following the base ones, each is either active (chunks
+        // are committed and owned by the bucket), or released back to the system. Changed under the bucket lock.
+        std::size_t slab_chunks = 0;
+        std::vector<uint8_t> slabs;
+        uint32_t slab_first(std::size_t s) const noexcept { return static_cast<uint32_t>(count_base + s * slab_chunks); }
+
+        std::size_t index = 0;          // position in thread cache magazines
+        std::size_t tcache_limit = 0;   // max chunks cached per thread, 0: no caching
 
         friend class memPool;
     };
 
+    // per-thread magazines in front of shared buckets: acquire/release normally don't touch bucket locks,
+    // magazines are refilled and flushed in batches of half of their limit.
+    constexpr static std::size_t max_buckets = 16;
+    constexpr static std::size_t tcache_slots = 64;
+    struct thread_cache;
+    static thread_cache* tcache();
+    void tcache_setup(Bucket& b);
+    std::optional<mem_chunk> tcache_acquire(Bucket* b);
+    bool tcache_release(Bucket* b, unsigned char* ptr);
+
     /// @return the right bucket for the required size @param s. If none is available,
     /// `nullptr` is returned.
     Bucket* pick_bucket(size_t s);
@@ -213,19 +300,46 @@ class memPool {
     /// Free heap-allocated memory
     void free_heap(mem_chunk const& mch);
 
-    Bucket bucket_32 {32};
-    Bucket bucket_64 {64};
-    Bucket bucket_128 {128};
-    Bucket bucket_256 {256};
-    Bucket bucket_1k {1024};
-    Bucket bucket_5k {5L*1024};
-    Bucket bucket_10k {10L*1024};
-    Bucket bucket_20k {20L*1024};
-    Bucket bucket_35k {35L*1024};
-    Bucket bucket_50k {50L*1024};
+    mem_chunk_t acquire_chunk(std::size_t sz);
+    void release_chunk(mem_chunk_t to_ret);
+
+    /// trim buckets if elastic_trim_sec elapsed since the last time
+    void trim_maybe();
+    std::atomic<long long> trim_last_ {0};
+
+    // buckets in size order, class_size_ mirrors their chunk sizes for the lookup
+    size_table table_;
+    std::array<std::unique_ptr<Bucket>, max_buckets> classes_;
+    std::array<std::size_t, max_buckets> class_size_ {};
+    std::size_t classes_count_ = 0;
 
     std::set<Bucket*> buckets;
 
+    // Buckets are carved from one reserved address range: bucket with 'index' owns region starting at
+    // arena_ + (index << arena_region_shift_). Owner of a pointer is then found by arithmetic, not by search.
+    // Region fits the biggest bucket at its configured maximum (base chunks and elastic growth), rounded up to
+    // a power of two.
+    unsigned int arena_region_shift_ = 0;
+    std::size_t arena_bytes_ = 0;
+    uint8_t* arena_ = nullptr;
+    std::array<Bucket*, max_buckets> arena_owner_ {};
+    bool arena_only_ = false;   // all buckets are in the arena, pointers outside are not ours
+    void arena_reserve(std::size_t region_size);
+    bool arena_contains(void const* ptr) const noexcept {
+        auto const* p = static_cast<uint8_t const*>(ptr);
+        return arena_ and p >= arena_ and p < arena_ + arena_bytes_;
+    }
+
+    // lookup in this pool only
+    Bucket* find_local(void* ptr);
+    bool is_local(Bucket const* b) const noexcept { return b->index < classes_count_ and classes_[b->index].get() == b; }
+
+    // NUMA node this pool's memory is bound to, -1 if not bound
+    int node_ = -1;
+    constexpr static std::size_t max_nodes = 8;
+    static std::array<std::atomic<memPool*>, max_nodes>& nodes();
+    static memPool& local_pool();
+
     using canary_t = mp_canary;
 
     static canary_t& get_canary() {
@@ -233,32 +347,89 @@ class memPool {
         return c;
     };
 
-    memPool(std::size_t sz256, std::size_t sz1k, std::size_t sz5k, std::size_t sz10k, std::size_t sz20k);
+    explicit memPool(int node = -1);
 
 public:
     std::set<Bucket*> const& get_buckets() const { return buckets; };
     std::set<Bucket*>& get_buckets() { return buckets; };
+    // reserved address space of buckets, 0 if they use heap
+    std::size_t arena_size() const { return arena_bytes_; };
 
     // indicate to not use any allocation functions which are not safe!
     // resource requests will fail and releases do nothing.
     static inline bool bailing = false;
 
+    /// @return pool of the calling thread's NUMA node (chosen on the first call in the thread)
     static memPool& pool() {
-        static auto m = memPool(100,50,50,10,8);
-        return m;
+        static thread_local memPool* local = nullptr;
+        if(not local) local = &local_pool();
+        return *local;
     }
 
-    void allocate(std::size_t sz256, std::size_t sz1k, std::size_t sz5k, std::size_t sz10k, std::size_t sz20k);
+    // per-node pools: memory of each is bound (MPOL_PREFERRED) to its node, chunks released to other node's pool
+    // are routed back to the owner. Must be set before the first use of the pool.
+    static inline bool numa_enabled = true;
+
+    /// @return number of NUMA nodes in the system (1 if unknown)
+    static std::size_t node_count();
+
+    /// @return pool for @param node, created on demand. Node 0 pool is the only pool without NUMA.
+    static memPool& node_pool(std::size_t node);
+    int node() const noexcept { return node_; }
+
+    /// create buckets from @param table, chunk counts multiplied by @param percent
+    void allocate(size_table const& table, std::size_t percent);
+
+    /// used instead of the default table if not empty, must be set before the first use of the pool
+    static inline size_table size_table_override;
+    size_table const& get_size_table() const { return table_; }
+
+    // record sizes of requests, see suggest_size_table()
+    static inline bool profile_sizes = false;
+    size_histogram size_profile;
+
+    /// @return table of at most @param classes sizes, covering profiled requests with the least over-allocation.
+    /// Counts split the current table's bytes by the share of bytes requested in each class.
+    size_table suggest_size_table(std::size_t classes = 10) const;
 
     static inline bool heap_on_tension = true;
 
+    // thread cache tunables, apply to buckets on allocate()
+    static inline bool tcache_enabled = true;
+    static inline std::size_t tcache_bytes = 256 * 1024;   // per bucket and thread
+    static inline std::size_t tcache_share = 32;           // thread may cache at most 1/share of bucket chunks
+
+    /// give chunks cached by calling thread back to buckets (done automatically on thread exit)
+    static void tcache_flush();
+
+    // elastic buckets: an empty bucket grows by a slab instead of falling back to the heap, slabs found
+    // completely free are given back to the system periodically (madvise). Apply on allocate().
+    static inline bool elastic_enabled = true;
+    static inline std::size_t elastic_slab_bytes = 2 * 1024 * 1024;
+    static inline std::size_t elastic_max_bytes = 512 * 1024 * 1024;  // growth limit per bucket
+    static inline bool elastic_thp = false;                            // ask for transparent huge pages
+    // applied on the run
+    static inline std::size_t elastic_spare_slabs = 1;                 // free slabs kept in each bucket
+    static inline unsigned int elastic_trim_sec = 30;                  // 0: trim only on explicit trim() call
+    static inline unsigned int elastic_trim_every = 4096;              // releases between trim timer checks
+
+    /// release completely free slabs of all buckets. @return number of slabs released
+    std::size_t trim();
+
     static std::atomic_bool& is_ready() {
         static std::atomic_bool is_ready_(false);
         return is_ready_;
     }
 
-    mem_chunk_t acquire(std::size_t sz);
-    void release(mem_chunk_t to_ret);
+    mem_chunk_t acquire(std::size_t sz) {
+        auto ret = acquire_chunk(sz);
+        alloc_sampler::alloc(ret.ptr, ret.capacity);
+        return ret;
+    }
+    void release(mem_chunk_t to_ret) {
+        alloc_sampler::release(to_ret.ptr);
+        release_chunk(to_ret);
+    }
 
     Bucket* find_by_address(void* ptr);
     std::size_t find_ptr_size(void* ptr);
@@ -281,6 +452,14 @@ public:
 
         std::atomic<unsigned long long> out_pool_miss{0};
         std::atomic<unsigned long long> out_pool_miss_size{0};
+
+        std::atomic<unsigned long long> tcache_refill{0};
+        std::atomic<unsigned long long> tcache_flush{0};
+
+        std::atomic<unsigned long long> elastic_grow{0};
+        std::atomic<unsigned long long> elastic_trim{0};
+
+        std::atomic<unsigned long long> remote_free{0};
     };
     stats_t stats;
 };
@@ -0,0 +1,278 @@
+/*
+    Socle - Socket Library Ecosystem
+    Copyright (c) 2014, Ales Stibal <astib@mag0.net>, All rights reserved.
+
+    This library  is free  software;  you can redistribute  it and/or
+    modify  it  under   the  terms of the  GNU Lesser  General Public
+    License  as published by  the   Free Software Foundation;  either
+    version 3.0 of the License, or (at your option) any later version.
+    This library is  distributed  in the hope that  it will be useful,
+    but WITHOUT ANY WARRANTY;  without  even  the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the GNU Lesser General Public License for more details.
+
+    You  should have received a copy of the GNU Lesser General Public
+    License along with this library.
+*/
+
+#ifndef OBJPOOL_HPP
+#define OBJPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace mp {
+
+    /// @brief typed slab pool for small, frequently created objects.
+    /// Slots are carved from slabs of SlabObjects, freed slots are kept on per-thread free lists and exchanged
+    /// with a shared list in batches. Slabs are never returned to the system (objects may be released late during
+    /// exit), memory is reused for the same type.
+    template <typename T, std::size_t SlabObjects = 64>
+    class object_pool {
+
+        union slot {
+            slot* next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        // thread's free list
+        struct local_list {
+            slot* head = nullptr;
+            std::size_t count = 0;
+            bool gone = false;
+
+            // allocated minus released by this thread (may go negative), written only by the owner
+            std::atomic<long> used {0};
+            void add_used(long n) { used.store(used.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+            local_list() {
+                object_pool::instance().enroll(this);
+            }
+
+            ~local_list() {
+                gone = true;
+                object_pool::instance().retire(this);
+                if(head) object_pool::instance().give_back(head, count);
+            }
+        };
+
+        static local_list& local() {
+            static thread_local local_list l;
+            return l;
+        }
+
+        mutable std::mutex lock_;
+        slot* shared_head_ = nullptr;
+        std::size_t shared_count_ = 0;
+        std::vector<slot*> slabs_;
+
+        // in-use counters are per thread, summed only in in_use()
+        std::vector<local_list*> lists_;
+        long retired_used_ = 0;     // exited threads, and allocations done after thread's list is gone
+
+        object_pool() = default;
+
+        void enroll(local_list* l) {
+            auto l_ = std::scoped_lock(lock_);
+            lists_.push_back(l);
+        }
+
+        void retire(local_list* l) {
+            auto l_ = std::scoped_lock(lock_);
+            retired_used_ += l->used.load(std::memory_order_relaxed);
+            lists_.erase(std::remove(lists_.begin(), lists_.end(), l), lists_.end());
+        }
+
+        // take up to 'n' slots from the shared list, make a new slab if it's empty
+        slot* take(std::size_t n, std::size_t& taken) {
+            auto l_ = std::scoped_lock(lock_);
+
+            if(not shared_head_) {
+                auto* slab = static_cast<slot*>(::operator new(sizeof(slot) * SlabObjects, std::align_val_t(alignof(slot))));
+                slabs_.push_back(slab);
+
+                for(std::size_t i = 0; i < SlabObjects; ++i) {
+                    slab[i].next = i + 1 < SlabObjects ? &slab[i + 1] : shared_head_;
+                }
+                shared_head_ = slab;
+                shared_count_ += SlabObjects;
+            }
+
+            auto* first = shared_head_;
+            auto* last = first;
+            taken = 1;
+            while(taken < n and last->next) {
+                last = last->next;
+                ++taken;
+            }
+            shared_head_ = last->next;
+            shared_count_ -= taken;
+            last->next = nullptr;
+
+            return first;
+        }
+
+        void give_back(slot* first, std::size_t n) {
+            auto* last = first;
+            while(last->next) last = last->next;
+
+            auto l_ = std::scoped_lock(lock_);
+            last->next = shared_head_;
+            shared_head_ = first;
+            shared_count_ += n;
+        }
+
+    public:
+        // thread keeps at most this many free slots, then half of them goes to the shared list
+        static inline std::size_t local_max = 2 * SlabObjects;
+
+        static object_pool& instance() {
+            static object_pool p;
+            return p;
+        }
+
+        object_pool(object_pool const&) = delete;
+        object_pool& operator=(object_pool const&) = delete;
+
+        /// @return uninitialized storage for one T
+        void* allocate() {
+            auto& l = local();
+            if(l.gone) {
+                std::size_t taken = 0;
+                auto* s = take(1, taken);
+
+                auto l_ = std::scoped_lock(lock_);
+                ++retired_used_;
+                return s->storage;
+            }
+
+            if(not l.head) {
+                l.head = take(std::max<std::size_t>(local_max / 2, 1), l.count);
+            }
+
+            auto* s = l.head;
+            l.head = s->next;
+            --l.count;
+            l.add_used(1);
+
+            return s->storage;
+        }
+
+        void deallocate(void* ptr) {
+            if(not ptr) return;
+
+            auto* s = static_cast<slot*>(ptr);
+
+            auto& l = local();
+            if(l.gone) {
+                s->next = nullptr;
+                give_back(s, 1);
+
+                auto l_ = std::scoped_lock(lock_);
+                --retired_used_;
+                return;
+            }
+
+            l.add_used(-1);
+            s->next = l.head;
+            l.head = s;
+            ++l.count;
+
+            if(l.count > local_max) {
+                // keep the recently freed (cache-warm) half
+                auto keep = l.count / 2;
+                auto* last = l.head;
+                for(std::size_t i = 1; i < keep; ++i) last = last->next;
+
+                auto* rest = last->next;
+                last->next = nullptr;
+                give_back(rest, l.count - keep);
+                l.count = keep;
+            }
+        }
+
+        template <typename ... Args>
+        T* create(Args&& ... args) {
+            auto* mem = allocate();
+            try {
+                return new (mem) T(std::forward<Args>(args)...);
+            }
+            catch(...) {
+                deallocate(mem);
+                throw;
+            }
+        }
+
+        void destroy(T* obj) {
+            if(not obj) return;
+
+            obj->~T();
+            deallocate(obj);
+        }
+
+        [[nodiscard]] std::size_t in_use() const {
+            auto l_ = std::scoped_lock(lock_);
+
+            long sum = retired_used_;
+            for(auto const* l: lists_) sum += l->used.load(std::memory_order_relaxed);
+            return static_cast<std::size_t>(std::max(sum, 0L));
+        }
+        [[nodiscard]] std::size_t slabs() const { auto l_ = std::scoped_lock(lock_); return slabs_.size(); }
+        [[nodiscard]] std::size_t shared_free() const { auto l_ = std::scoped_lock(lock_); return shared_count_; }
+
+        struct deleter {
+            void operator()(T* obj) const { object_pool::instance().destroy(obj); }
+        };
+    };
+
+    template <typename T>
+    using pooled_ptr = std::unique_ptr<T, typename object_pool<T>::deleter>;
+
+    template <typename T, typename ... Args>
+    pooled_ptr<T> make_pooled(Args&& ... args) {
+        return pooled_ptr<T>(object_pool<T>::instance().create(std::forward<Args>(args)...));
+    }
+
+
+    /// @brief allocator for std::allocate_shared, single objects (control block with the object) come from
+    /// object_pool of the rebound type, arrays go to the heap.
+    template <typename T>
+    struct object_pool_allocator {
+        using value_type = T;
+
+        object_pool_allocator() = default;
+        template <typename U>
+        object_pool_allocator(object_pool_allocator<U> const&) noexcept {}
+
+        T* allocate(std::size_t n) {
+            if(n == 1) return static_cast<T*>(object_pool<T>::instance().allocate());
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        }
+
+        void deallocate(T* p, std::size_t n) {
+            if(n == 1) object_pool<T>::instance().deallocate(p);
+            else ::operator delete(p, std::align_val_t(alignof(T)));
+        }
+
+        template <typename U>
+        struct rebind { using other = object_pool_allocator<U>; };
+
+        template <typename U>
+        bool operator==(object_pool_allocator<U> const&) const noexcept { return true; }
+        template <typename U>
+        bool operator!=(object_pool_allocator<U> const&) const noexcept { return false; }
+    };
+
+    /// @brief std::make_shared replacement, object and its control block share one pooled slot
+    template <typename T, typename ... Args>
+    std::shared_ptr<T> make_pooled_shared(Args&& ... args) {
+        return std::allocate_shared<T>(object_pool_allocator<T>(), std::forward<Args>(args)...);
+    }
+}
+
+#endif //OBJPOOL_HPP
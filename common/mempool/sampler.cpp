@@ -0,0 +1,354 @@
+/*
+    Socle - Socket Library Ecosystem
+    Copyright (c) 2014, Ales Stibal <astib@mag0.net>, All rights reserved.
+
+    This library  is free  software;  you can redistribute  it and/or
+    modify  it  under   the  terms of the  GNU Lesser  General Public
+    License  as published by  the   Free Software Foundation;  either
+    version 3.0 of the License, or (at your option) any later version.
+    This library is  distributed  in the hope that  it will be useful,
+    but WITHOUT ANY WARRANTY;  without  even  the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the GNU Lesser General Public License for more details.
+
+    You  should have received a copy of the GNU Lesser General Public
+    License along with this library.
+*/
+
+#include <mempool/sampler.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include <execinfo.h>
+
+namespace {
+
+    struct site {
+        std::atomic<uint64_t> hash {0};         // 0: free slot
+        std::atomic<bool> ready {false};        // frames are written
+        std::array<void*, alloc_sampler::max_frames> frames {};
+        int depth = 0;
+
+        std::atomic<unsigned long long> samples {0};
+        std::atomic<unsigned long long> bytes {0};
+        std::atomic<unsigned long long> live_samples {0};
+        std::atomic<unsigned long long> live_bytes {0};
+    };
+
+    // ptr: 0 empty. Table is changed only under live_lock(), data is written before ptr is published.
+    // Erase shifts following entries back (no tombstones), so a lookup ends at the first empty slot. Lookups are
+    // lock-free: a miss is trusted only if no erase ran meanwhile (live_seq() is odd during an erase).
+    struct live_entry {
+        std::atomic<uintptr_t> ptr {0};
+        std::atomic<uint64_t> data {0};
+    };
+    constexpr unsigned int weight_bits = 40;
+
+    std::array<site, alloc_sampler::max_sites>& site_table() {
+        static std::array<site, alloc_sampler::max_sites> t;
+        return t;
+    }
+
+    std::array<live_entry, alloc_sampler::max_live>& live_table() {
+        static std::array<live_entry, alloc_sampler::max_live> t;
+        return t;
+    }
+
+    std::mutex& live_lock() {
+        static std::mutex m;
+        return m;
+    }
+
+    std::atomic<uint64_t>& live_seq() {
+        static std::atomic<uint64_t> seq {0};
+        return seq;
+    }
+
+    thread_local bool in_sampler = false;
+
+    uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // exponentially distributed distance to the next sample, mean sample_bytes
+    long long next_distance() {
+        static thread_local uint64_t state = mix(reinterpret_cast<uintptr_t>(&state) ^ 0x9e3779b97f4a7c15ULL);
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        auto u = (static_cast<double>(state >> 11) + 0.5) / static_cast<double>(1ULL << 53);
+        return static_cast<long long>(-std::log(u) * static_cast<double>(alloc_sampler::sample_bytes)) + 1;
+    }
+
+    std::size_t live_home(uintptr_t key) {
+        return static_cast<std::size_t>(mix(key)) & (alloc_sampler::max_live - 1);
+    }
+
+    // @return slot of 'key', max_live if not present
+    // @param probes if set, receives number of slots scanned
+    std::size_t live_find(uintptr_t key, std::size_t* probes = nullptr) {
+        auto& lt = live_table();
+        auto slot = live_home(key);
+
+        std::size_t n = 0;
+        std::size_t ret = alloc_sampler::max_live;
+        for(; n < alloc_sampler::max_live; slot = (slot + 1) & (alloc_sampler::max_live - 1)) {
+            auto cur = lt[slot].ptr.load(std::memory_order_acquire);
+            ++n;
+            if(cur == key) { ret = slot; break; }
+            if(cur == 0) break;
+        }
+
+        if(probes) *probes = n;
+        return ret;
+    }
+
+    // backward-shift deletion, called with live_lock() held
+    void live_erase(std::size_t hole) {
+        auto& lt = live_table();
+        constexpr auto mask = alloc_sampler::max_live - 1;
+
+        live_seq().fetch_add(1, std::memory_order_acq_rel);
+
+        for(auto slot = (hole + 1) & mask; ; slot = (slot + 1) & mask) {
+            auto cur = lt[slot].ptr.load(std::memory_order_relaxed);
+            if(cur == 0) break;
+
+            // entry may move to the hole only if the hole is not before its home slot
+            auto home = live_home(cur);
+            if(((slot - home) & mask) < ((slot - hole) & mask)) continue;
+
+            lt[hole].data.store(lt[slot].data.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            lt[hole].ptr.store(cur, std::memory_order_release);
+            hole = slot;
+        }
+        lt[hole].ptr.store(0, std::memory_order_release);
+
+        live_seq().fetch_add(1, std::memory_order_release);
+    }
+
+    std::size_t find_site(void* const* frames, int depth) {
+        uint64_t h = 0x84222325cbf29ce4ULL;
+        for(int i = 0; i < depth; ++i) h = mix(h ^ reinterpret_cast<uintptr_t>(frames[i]));
+        if(h == 0) h = 1;
+
+        auto& t = site_table();
+        auto idx = static_cast<std::size_t>(h) & (alloc_sampler::max_sites - 1);
+
+        for(std::size_t n = 0; n < alloc_sampler::max_sites; ++n, idx = (idx + 1) & (alloc_sampler::max_sites - 1)) {
+            auto& s = t[idx];
+            auto cur = s.hash.load(std::memory_order_acquire);
+
+            if(cur == h) return idx;
+            if(cur != 0) continue;
+
+            if(s.hash.compare_exchange_strong(cur, h, std::memory_order_acq_rel)) {
+                std::copy(frames, frames + depth, s.frames.begin());
+                s.depth = depth;
+                s.ready.store(true, std::memory_order_release);
+                return idx;
+            }
+            if(cur == h) return idx;
+        }
+
+        return alloc_sampler::max_sites;
+    }
+}
+
+long long& alloc_sampler::bytes_left() {
+    static thread_local long long left = next_distance();
+    return left;
+}
+
+std::atomic<std::size_t>& alloc_sampler::live_count() {
+    static std::atomic<std::size_t> c {0};
+    return c;
+}
+
+void alloc_sampler::record(void const* ptr, std::size_t sz) {
+    auto& left = bytes_left();
+
+    // allocations done by backtrace() itself are not sampled
+    if(in_sampler) {
+        left = next_distance();
+        return;
+    }
+    in_sampler = true;
+
+    // one sample represents sz / P(sampled) bytes
+    auto const mean = static_cast<double>(sample_bytes);
+    auto const p = 1.0 - std::exp(-static_cast<double>(sz) / mean);
+    auto const weight = static_cast<uint64_t>(static_cast<double>(sz) / std::max(p, 1e-12));
+
+    while(left <= 0) left += next_distance();
+
+    std::array<void*, max_frames + 2> frames {};
+    auto depth = ::backtrace(frames.data(), static_cast<int>(frames.size()));
+
+    // skip record() itself, alloc() is usually inlined
+    auto const skip = std::min(depth, 1);
+    auto const idx = find_site(frames.data() + skip, std::min(depth - skip, static_cast<int>(max_frames)));
+    counters().sampled++;
+
+    if(idx >= max_sites) {
+        counters().dropped_sites++;
+        in_sampler = false;
+        return;
+    }
+
+    auto& s = site_table()[idx];
+    s.samples.fetch_add(1, std::memory_order_relaxed);
+    s.bytes.fetch_add(weight, std::memory_order_relaxed);
+
+    auto const w = std::min<uint64_t>(weight, (1ULL << weight_bits) - 1);
+    auto const key = reinterpret_cast<uintptr_t>(ptr);
+    {
+        auto l_ = std::scoped_lock(live_lock());
+
+        // keep probe sequences short
+        if(live_count().load(std::memory_order_relaxed) >= max_live / 4 * 3) {
+            counters().dropped_live++;
+            in_sampler = false;
+            return;
+        }
+
+        auto& lt = live_table();
+        auto slot = live_home(key);
+        while(lt[slot].ptr.load(std::memory_order_relaxed) != 0) slot = (slot + 1) & (max_live - 1);
+
+        lt[slot].data.store((static_cast<uint64_t>(idx) << weight_bits) | w, std::memory_order_relaxed);
+        lt[slot].ptr.store(key, std::memory_order_release);
+        live_count().fetch_add(1, std::memory_order_relaxed);
+    }
+
+    s.live_samples.fetch_add(1, std::memory_order_relaxed);
+    s.live_bytes.fetch_add(w, std::memory_order_relaxed);
+
+    in_sampler = false;
+}
+
+std::size_t alloc_sampler::probe_length(void const* ptr) {
+    auto l_ = std::scoped_lock(live_lock());
+
+    std::size_t probes = 0;
+    live_find(reinterpret_cast<uintptr_t>(ptr), &probes);
+    return probes;
+}
+
+void alloc_sampler::forget(void const* ptr) {
+    auto const key = reinterpret_cast<uintptr_t>(ptr);
+
+    // lock-free lookup: almost all released pointers were never sampled
+    for(;;) {
+        auto const seq = live_seq().load(std::memory_order_acquire);
+        if(seq % 2 == 0) {
+            if(live_find(key) < max_live) break;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(live_seq().load(std::memory_order_acquire) == seq) return;
+        }
+    }
+
+    uint64_t data = 0;
+    {
+        auto l_ = std::scoped_lock(live_lock());
+
+        auto slot = live_find(key);
+        if(slot >= max_live) return;
+
+        data = live_table()[slot].data.load(std::memory_order_relaxed);
+        live_erase(slot);
+        live_count().fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    auto& s = site_table()[data >> weight_bits];
+    s.live_samples.fetch_sub(1, std::memory_order_relaxed);
+    s.live_bytes.fetch_sub(data & ((1ULL << weight_bits) - 1), std::memory_order_relaxed);
+}
+
+std::vector<alloc_sampler::site_stats> alloc_sampler::sites() {
+    std::vector<site_stats> ret;
+
+    for(auto const& s: site_table()) {
+        if(not s.ready.load(std::memory_order_acquire)) continue;
+
+        site_stats st;
+        st.frames.assign(s.frames.begin(), s.frames.begin() + s.depth);
+        st.samples = s.samples.load(std::memory_order_relaxed);
+        st.bytes = s.bytes.load(std::memory_order_relaxed);
+        st.live_samples = s.live_samples.load(std::memory_order_relaxed);
+        st.live_bytes = s.live_bytes.load(std::memory_order_relaxed);
+        ret.push_back(std::move(st));
+    }
+
+    std::sort(ret.begin(), ret.end(), [](auto const& a, auto const& b) {
+        return a.live_bytes != b.live_bytes ? a.live_bytes > b.live_bytes : a.bytes > b.bytes;
+    });
+    return ret;
+}
+
+std::string alloc_sampler::dump(std::size_t top) {
+    std::stringstream ss;
+
+    auto all = sites();
+    ss << "allocation sampler: " << (enabled ? "enabled" : "disabled") << ", 1 sample per " << sample_bytes << "B, "
+       << counters().sampled << " samples, " << all.size() << " sites, " << live_count().load() << " live samples";
+    if(counters().dropped_sites > 0 or counters().dropped_live > 0) {
+        ss << ", dropped: " << counters().dropped_sites << " sites, " << counters().dropped_live << " live";
+    }
+    ss << "\n";
+
+    std::size_t n = 0;
+    for(auto const& st: all) {
+        if(n++ >= top) break;
+
+        ss << "\n#" << n << ": live ~" << st.live_bytes << "B (" << st.live_samples << " samples), total ~"
+           << st.bytes << "B (" << st.samples << " samples)\n";
+
+        auto symbols = std::unique_ptr<char*, decltype(&::free)>(
+                ::backtrace_symbols(st.frames.data(), static_cast<int>(st.frames.size())), &::free);
+
+        for(std::size_t i = 0; i < st.frames.size(); ++i) {
+            ss << "    ";
+            if(symbols) ss << symbols.get()[i];
+            else ss << st.frames[i];
+            ss << "\n";
+        }
+    }
+
+    return ss.str();
+}
+
+void alloc_sampler::reset() {
+    for(auto& e: live_table()) {
+        e.ptr.store(0, std::memory_order_relaxed);
+        e.data.store(0, std::memory_order_relaxed);
+    }
+    live_count().store(0);
+
+    for(auto& s: site_table()) {
+        s.ready.store(false, std::memory_order_relaxed);
+        s.depth = 0;
+        s.samples = 0;
+        s.bytes = 0;
+        s.live_samples = 0;
+        s.live_bytes = 0;
+        s.hash.store(0, std::memory_order_release);
+    }
+
+    counters().sampled = 0;
+    counters().dropped_sites = 0;
+    counters().dropped_live = 0;
+}
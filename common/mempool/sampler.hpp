@@ -0,0 +1,98 @@
+/*
+    Socle - Socket Library Ecosystem
+    Copyright (c) 2014, Ales Stibal <astib@mag0.net>, All rights reserved.
+
+    This library  is free  software;  you can redistribute  it and/or
+    modify  it  under   the  terms of the  GNU Lesser  General Public
+    License  as published by  the   Free Software Foundation;  either
+    version 3.0 of the License, or (at your option) any later version.
+    This library is  distributed  in the hope that  it will be useful,
+    but WITHOUT ANY WARRANTY;  without  even  the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the GNU Lesser General Public License for more details.
+
+    You  should have received a copy of the GNU Lesser General Public
+    License along with this library.
+*/
+
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// @brief sampling allocation profiler for memPool allocations.
+/// On average one allocation per 'sample_bytes' allocated bytes is sampled (bigger ones more likely): its stack is
+/// captured (raw addresses only) into a fixed lock-free table of allocation sites, and the pointer is remembered
+/// until it's released. Each sample stands for sample-size-weighted bytes, so per-site totals estimate real ones.
+/// Symbols are resolved only in dump(). Cost of not sampled allocation is a thread-local counter decrement.
+struct alloc_sampler {
+
+    constexpr static std::size_t max_frames = 24;
+    constexpr static std::size_t max_sites = 4096;      // power of two
+    constexpr static std::size_t max_live = 65536;      // power of two, sampled allocations not released yet
+
+#ifdef SOCLE_MEM_PROFILE
+    static inline bool enabled = true;
+#else
+    static inline bool enabled = false;
+#endif
+    // mean distance between samples
+    static inline std::size_t sample_bytes = 512 * 1024;
+
+    static void alloc(void const* ptr, std::size_t sz) {
+        if(not enabled or not ptr) return;
+
+        auto& left = bytes_left();
+        left -= static_cast<long long>(sz);
+        if(left > 0) return;
+
+        record(ptr, sz);
+    }
+
+    static void release(void const* ptr) {
+        if(live_count().load(std::memory_order_relaxed) == 0 or not ptr) return;
+
+        forget(ptr);
+    }
+
+    struct site_stats {
+        std::vector<void*> frames;
+        unsigned long long samples = 0;
+        unsigned long long bytes = 0;           // estimated total allocated
+        unsigned long long live_samples = 0;
+        unsigned long long live_bytes = 0;      // estimated not released yet
+    };
+
+    /// @return snapshot of sites, sorted by live bytes, then by total bytes
+    static std::vector<site_stats> sites();
+
+    /// @return human readable report of @param top sites, with symbolized stacks
+    static std::string dump(std::size_t top = 20);
+
+    /// forget all sites and live samples. Not safe while allocating threads are sampling.
+    static void reset();
+
+    /// @return live table slots a lookup of @param ptr scans (diagnostics)
+    static std::size_t probe_length(void const* ptr);
+
+    struct counters_t {
+        std::atomic<unsigned long long> sampled {0};
+        std::atomic<unsigned long long> dropped_sites {0};      // site table full
+        std::atomic<unsigned long long> dropped_live {0};       // live table full
+    };
+    static counters_t& counters() { static counters_t c; return c; }
+
+private:
+    static long long& bytes_left();
+    static std::atomic<std::size_t>& live_count();
+
+    static void record(void const* ptr, std::size_t sz);
+    static void forget(void const* ptr);
+};
+
+#endif //SAMPLER_HPP
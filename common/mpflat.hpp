@@ -0,0 +1,381 @@
+/*
+    Socle - Socket Library Ecosystem
+    Copyright (c) 2014, Ales Stibal <astib@mag0.net>, All rights reserved.
+
+    This library  is free  software;  you can redistribute  it and/or
+    modify  it  under   the  terms of the  GNU Lesser  General Public
+    License  as published by  the   Free Software Foundation;  either
+    version 3.0 of the License, or (at your option) any later version.
+    This library is  distributed  in the hope that  it will be useful,
+    but WITHOUT ANY WARRANTY;  without  even  the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the GNU Lesser General Public License for more details.
+
+    You  should have received a copy of the GNU Lesser General Public
+    License along with this library.
+*/
+
+#ifndef MPFLAT_HPP
+#define MPFLAT_HPP
+
+#include <mempool/mpallocator.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace mp {
+
+    /// @brief sorted vector with set interface. Lookups are binary searches over contiguous memory, inserts and
+    /// erases shift the tail - good for small or rarely modified sets. Modifications invalidate iterators.
+    template<
+            class Key,
+            class Compare = std::less<Key>,
+            class Allocator = mp_allocator<Key>
+    >
+    class flat_set {
+        using storage_type = std::vector<Key, Allocator>;
+        storage_type data_;
+        Compare cmp_;
+
+    public:
+        using key_type = Key;
+        using value_type = Key;
+        using size_type = typename storage_type::size_type;
+        using iterator = typename storage_type::const_iterator;
+        using const_iterator = typename storage_type::const_iterator;
+
+        flat_set() = default;
+        flat_set(std::initializer_list<Key> l) { for(auto const& k: l) insert(k); }
+
+        const_iterator begin() const { return data_.cbegin(); }
+        const_iterator end() const { return data_.cend(); }
+        [[nodiscard]] size_type size() const { return data_.size(); }
+        [[nodiscard]] bool empty() const { return data_.empty(); }
+        void clear() { data_.clear(); }
+        void reserve(size_type n) { data_.reserve(n); }
+
+        const_iterator lower_bound(Key const& k) const { return std::lower_bound(data_.begin(), data_.end(), k, cmp_); }
+
+        const_iterator find(Key const& k) const {
+            auto it = lower_bound(k);
+            return (it != end() and not cmp_(k, *it)) ? it : end();
+        }
+        [[nodiscard]] size_type count(Key const& k) const { return find(k) != end() ? 1 : 0; }
+        [[nodiscard]] bool contains(Key const& k) const { return find(k) != end(); }
+
+        std::pair<iterator, bool> insert(Key const& k) {
+            auto it = std::lower_bound(data_.begin(), data_.end(), k, cmp_);
+            if(it != data_.end() and not cmp_(k, *it)) return { it, false };
+
+            return { data_.insert(it, k), true };
+        }
+
+        size_type erase(Key const& k) {
+            auto it = find(k);
+            if(it == end()) return 0;
+
+            data_.erase(it);
+            return 1;
+        }
+
+        iterator erase(const_iterator it) { return data_.erase(it); }
+    };
+
+
+    /// @brief sorted vector of key-value pairs with map interface, see flat_set.
+    /// Unlike std::map, keys in value_type are not const and references are invalidated by modifications.
+    template<
+            class Key,
+            class T,
+            class Compare = std::less<Key>,
+            class Allocator = mp_allocator<std::pair<Key, T>>
+    >
+    class flat_map {
+        using storage_type = std::vector<std::pair<Key, T>, Allocator>;
+        storage_type data_;
+        Compare cmp_;
+
+        auto key_less() const { return [this](auto const& elem, Key const& k) { return cmp_(elem.first, k); }; }
+
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<Key, T>;
+        using size_type = typename storage_type::size_type;
+        using iterator = typename storage_type::iterator;
+        using const_iterator = typename storage_type::const_iterator;
+
+        flat_map() = default;
+
+        iterator begin() { return data_.begin(); }
+        iterator end() { return data_.end(); }
+        const_iterator begin() const { return data_.cbegin(); }
+        const_iterator end() const { return data_.cend(); }
+        [[nodiscard]] size_type size() const { return data_.size(); }
+        [[nodiscard]] bool empty() const { return data_.empty(); }
+        void clear() { data_.clear(); }
+        void reserve(size_type n) { data_.reserve(n); }
+
+        iterator lower_bound(Key const& k) { return std::lower_bound(data_.begin(), data_.end(), k, key_less()); }
+        const_iterator lower_bound(Key const& k) const { return std::lower_bound(data_.begin(), data_.end(), k, key_less()); }
+
+        iterator find(Key const& k) {
+            auto it = lower_bound(k);
+            return (it != end() and not cmp_(k, it->first)) ? it : end();
+        }
+        const_iterator find(Key const& k) const {
+            auto it = lower_bound(k);
+            return (it != end() and not cmp_(k, it->first)) ? it : end();
+        }
+        [[nodiscard]] size_type count(Key const& k) const { return find(k) != end() ? 1 : 0; }
+        [[nodiscard]] bool contains(Key const& k) const { return find(k) != end(); }
+
+        template <class ... Args>
+        std::pair<iterator, bool> try_emplace(Key const& k, Args&& ... args) {
+            auto it = lower_bound(k);
+            if(it != end() and not cmp_(k, it->first)) return { it, false };
+
+            return { data_.emplace(it, std::piecewise_construct, std::forward_as_tuple(k),
+                                   std::forward_as_tuple(std::forward<Args>(args)...)), true };
+        }
+
+        std::pair<iterator, bool> insert(value_type const& v) { return try_emplace(v.first, v.second); }
+
+        template <class M>
+        std::pair<iterator, bool> insert_or_assign(Key const& k, M&& m) {
+            auto [ it, inserted ] = try_emplace(k, std::forward<M>(m));
+            if(not inserted) it->second = std::forward<M>(m);
+            return { it, inserted };
+        }
+
+        T& operator[](Key const& k) { return try_emplace(k).first->second; }
+
+        T& at(Key const& k) {
+            auto it = find(k);
+            if(it == end()) throw std::out_of_range("flat_map::at");
+            return it->second;
+        }
+        T const& at(Key const& k) const {
+            auto it = find(k);
+            if(it == end()) throw std::out_of_range("flat_map::at");
+            return it->second;
+        }
+
+        size_type erase(Key const& k) {
+            auto it = find(k);
+            if(it == end()) return 0;
+
+            data_.erase(it);
+            return 1;
+        }
+
+        iterator erase(const_iterator it) { return data_.erase(it); }
+    };
+
+
+    /// @brief open-addressing hash map (linear probing, backward-shift deletion, no tombstones).
+    /// Elements live in one contiguous table of power-of-two size, grown when load exceeds 3/4.
+    /// Modifications invalidate iterators and references; erase(iterator) returns iterator to continue with,
+    /// but an element may be visited twice if a probe chain wraps around the end of the table.
+    template<
+            class Key,
+            class T,
+            class Hash = std::hash<Key>,
+            class KeyEqual = std::equal_to<Key>,
+            class Allocator = mp_allocator<std::optional<std::pair<Key, T>>>
+    >
+    class hash_map {
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<Key, T>;
+        using size_type = std::size_t;
+
+    private:
+        using slot_type = std::optional<value_type>;
+        using storage_type = std::vector<slot_type, typename std::allocator_traits<Allocator>::template rebind_alloc<slot_type>>;
+
+        storage_type slots_;
+        size_type size_ = 0;
+        Hash hash_;
+        KeyEqual eq_;
+
+        constexpr static size_type min_capacity = 8;
+
+        size_type mask() const { return slots_.size() - 1; }
+        size_type home(Key const& k) const {
+            // spread low-entropy hashes (std::hash<int> is identity) over the whole table
+            auto h = static_cast<uint64_t>(hash_(k)) * 0x9e3779b97f4a7c15ULL;
+            return static_cast<size_type>(h >> 32) & mask();
+        }
+
+        // slot holding 'k', or the empty slot where it would go
+        size_type probe(Key const& k) const {
+            auto i = home(k);
+            while(slots_[i] and not eq_(slots_[i]->first, k)) i = (i + 1) & mask();
+            return i;
+        }
+
+        void rehash(size_type cap) {
+            storage_type old(cap);
+            old.swap(slots_);
+
+            for(auto& s: old) {
+                if(s) slots_[probe(s->first)].emplace(std::move(*s));
+            }
+        }
+
+        void reserve_one() {
+            if(slots_.empty()) rehash(min_capacity);
+            else if((size_ + 1) * 4 > slots_.size() * 3) rehash(slots_.size() * 2);
+        }
+
+        void erase_slot(size_type i) {
+            slots_[i].reset();
+            --size_;
+
+            // shift following elements of the chain back, so lookups never stop on a hole
+            auto hole = i;
+            for(auto j = (i + 1) & mask(); slots_[j]; j = (j + 1) & mask()) {
+                auto h = home(slots_[j]->first);
+
+                // element can move to the hole only if the hole is cyclically between its home and j
+                if(((j - h) & mask()) >= ((j - hole) & mask())) {
+                    slots_[hole].emplace(std::move(*slots_[j]));
+                    slots_[j].reset();
+                    hole = j;
+                }
+            }
+        }
+
+        template <bool Const>
+        class iterator_base {
+            using map_type = std::conditional_t<Const, hash_map const, hash_map>;
+            map_type* map_ = nullptr;
+            size_type i_ = 0;
+
+            void skip() { while(i_ < map_->slots_.size() and not map_->slots_[i_]) ++i_; }
+
+            friend class hash_map;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = hash_map::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<Const, value_type const*, value_type*>;
+            using reference = std::conditional_t<Const, value_type const&, value_type&>;
+
+            iterator_base() = default;
+            iterator_base(map_type* m, size_type i) : map_(m), i_(i) { skip(); }
+            template <bool C = Const, typename = std::enable_if_t<C>>
+            iterator_base(iterator_base<false> const& r) : map_(r.map_), i_(r.i_) {}
+
+            reference operator*() const { return *map_->slots_[i_]; }
+            pointer operator->() const { return &*map_->slots_[i_]; }
+
+            iterator_base& operator++() { ++i_; skip(); return *this; }
+            iterator_base operator++(int) { auto r = *this; ++*this; return r; }
+
+            bool operator==(iterator_base const& r) const { return i_ == r.i_; }
+            bool operator!=(iterator_base const& r) const { return i_ != r.i_; }
+
+            template <bool> friend class iterator_base;
+        };
+
+    public:
+        using iterator = iterator_base<false>;
+        using const_iterator = iterator_base<true>;
+
+        hash_map() = default;
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, slots_.size()); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, slots_.size()); }
+
+        [[nodiscard]] size_type size() const { return size_; }
+        [[nodiscard]] bool empty() const { return size_ == 0; }
+        [[nodiscard]] size_type capacity() const { return slots_.size(); }
+
+        void clear() {
+            for(auto& s: slots_) s.reset();
+            size_ = 0;
+        }
+
+        void reserve(size_type n) {
+            auto cap = std::max(slots_.size(), min_capacity);
+            while(n * 4 > cap * 3) cap *= 2;
+            if(cap != slots_.size()) rehash(cap);
+        }
+
+        iterator find(Key const& k) {
+            if(size_ == 0) return end();
+            auto i = probe(k);
+            return slots_[i] ? iterator(this, i) : end();
+        }
+        const_iterator find(Key const& k) const {
+            if(size_ == 0) return end();
+            auto i = probe(k);
+            return slots_[i] ? const_iterator(this, i) : end();
+        }
+        [[nodiscard]] size_type count(Key const& k) const { return find(k) != end() ? 1 : 0; }
+        [[nodiscard]] bool contains(Key const& k) const { return find(k) != end(); }
+
+        template <class ... Args>
+        std::pair<iterator, bool> try_emplace(Key const& k, Args&& ... args) {
+            if(auto it = find(k); it != end()) return { it, false };
+
+            reserve_one();
+            auto i = probe(k);
+            slots_[i].emplace(std::piecewise_construct, std::forward_as_tuple(k),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+            ++size_;
+
+            return { iterator(this, i), true };
+        }
+
+        std::pair<iterator, bool> insert(value_type const& v) { return try_emplace(v.first, v.second); }
+
+        template <class M>
+        std::pair<iterator, bool> insert_or_assign(Key const& k, M&& m) {
+            auto [ it, inserted ] = try_emplace(k, std::forward<M>(m));
+            if(not inserted) it->second = std::forward<M>(m);
+            return { it, inserted };
+        }
+
+        T& operator[](Key const& k) { return try_emplace(k).first->second; }
+
+        T& at(Key const& k) {
+            auto it = find(k);
+            if(it == end()) throw std::out_of_range("hash_map::at");
+            return it->second;
+        }
+        T const& at(Key const& k) const {
+            auto it = find(k);
+            if(it == end()) throw std::out_of_range("hash_map::at");
+            return it->second;
+        }
+
+        size_type erase(Key const& k) {
+            if(size_ == 0) return 0;
+
+            auto i = probe(k);
+            if(not slots_[i]) return 0;
+
+            erase_slot(i);
+            return 1;
+        }
+
+        iterator erase(const_iterator it) {
+            auto i = it.i_;
+            erase_slot(i);
+            return iterator(this, i);
+        }
+    };
+}
+
+#endif //MPFLAT_HPP
@@ -21,6 +21,7 @@
 #define SMITHPROXY_MPSTD_HPP
 
 #include <mempool/mpallocator.hpp>
+#include <mpflat.hpp>
 
 #include <deque>
 #include <list>
@@ -0,0 +1,78 @@
+#ifndef PIPEPOOL_HPP
+#define PIPEPOOL_HPP
+
+#include <mutex>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/// @brief process-wide pool of non-blocking pipes used as splice() intermediaries.
+/// Creating a pipe costs two syscalls and two fds, so empty pipes are returned here and reused. Pipes still
+/// holding data must not be released, close them instead (their content belongs to a dead connection).
+struct pipe_pool {
+
+    struct pipe_pair {
+        int r = -1;
+        int w = -1;
+
+        [[nodiscard]] bool valid() const { return r >= 0 and w >= 0; }
+    };
+
+    // keep at most this many idle pipes
+    static inline std::size_t max_idle = 256;
+    // F_SETPIPE_SZ applied to new pipes, 0 keeps kernel default (usually 64kB)
+    static inline int pipe_size = 0;
+
+    static pipe_pair acquire() {
+        {
+            auto l_ = std::scoped_lock(lock());
+            auto& p = idle();
+            if(not p.empty()) {
+                auto ret = p.back();
+                p.pop_back();
+                return ret;
+            }
+        }
+
+        int fds[2];
+        if(::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) return {};
+
+        if(pipe_size > 0) {
+            // may fail on limits, kernel default is still usable
+            ::fcntl(fds[1], F_SETPIPE_SZ, pipe_size);
+        }
+
+        return { fds[0], fds[1] };
+    }
+
+    /// @brief give back empty pipe
+    static void release(pipe_pair p) {
+        if(not p.valid()) return;
+
+        {
+            auto l_ = std::scoped_lock(lock());
+            if(idle().size() < max_idle) {
+                idle().push_back(p);
+                return;
+            }
+        }
+        close(p);
+    }
+
+    static void close(pipe_pair p) {
+        if(p.r >= 0) ::close(p.r);
+        if(p.w >= 0) ::close(p.w);
+    }
+
+    static std::size_t idle_count() {
+        auto l_ = std::scoped_lock(lock());
+        return idle().size();
+    }
+
+private:
+    static std::mutex& lock() { static std::mutex m; return m; }
+    static std::vector<pipe_pair>& idle() { static std::vector<pipe_pair> v; return v; }
+};
+
+#endif //PIPEPOOL_HPP
@@ -17,8 +17,8 @@
 */
 
 
-// Uncomment line below and enable extensive buffer object profiling.
-// Warning: it's resource intensive.
+// Uncomment line below to start with sampling allocation profiler enabled (see alloc_sampler, it can be also
+// switched on at runtime) and to record sobject creation backtraces. Warning: sobject backtraces are resource intensive.
 
 //#define SOCLE_MEM_PROFILE
 
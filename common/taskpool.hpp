@@ -0,0 +1,109 @@
+#ifndef TASKPOOL_HPP
+#define TASKPOOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief persistent pool of worker threads executing tasks from a bounded FIFO queue.
+/// Threads are started lazily on the first submit() and live until the pool is destroyed.
+/// submit() never blocks: if the queue is full, it returns false and caller should run the task itself.
+struct task_pool {
+
+    using task_type = std::function<void()>;
+
+    task_pool(unsigned int threads, std::size_t queue_capacity) : thread_count_(threads > 0 ? threads : 1),
+                                                                  ring_(queue_capacity > 0 ? queue_capacity : 1) {}
+
+    task_pool(task_pool const&) = delete;
+    task_pool& operator=(task_pool const&) = delete;
+
+    ~task_pool() {
+        {
+            auto l_ = std::scoped_lock(lock_);
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+
+        // queued tasks are finished before threads exit
+        for(auto& t: threads_) {
+            if(t.joinable()) t.join();
+        }
+    }
+
+    /// @brief queue task, return false if queue is full (or pool is stopping)
+    bool submit(task_type task) {
+        {
+            auto l_ = std::scoped_lock(lock_);
+            if(stop_ or queued_ == ring_.size()) return false;
+
+            if(threads_.empty()) start_ul();
+
+            ring_[(head_ + queued_) % ring_.size()] = std::move(task);
+            ++queued_;
+            ++outstanding_;
+        }
+        work_cv_.notify_one();
+
+        return true;
+    }
+
+    /// @brief block until all submitted tasks are finished
+    void wait_idle() {
+        auto l_ = std::unique_lock(lock_);
+        idle_cv_.wait(l_, [this] { return outstanding_ == 0; });
+    }
+
+    [[nodiscard]] std::size_t outstanding() const {
+        auto l_ = std::scoped_lock(lock_);
+        return outstanding_;
+    }
+
+    [[nodiscard]] unsigned int thread_count() const { return thread_count_; }
+    [[nodiscard]] std::size_t capacity() const { return ring_.size(); }
+
+private:
+    void start_ul() {
+        threads_.reserve(thread_count_);
+        for(unsigned int i = 0; i < thread_count_; ++i) {
+            threads_.emplace_back([this] { run(); });
+        }
+    }
+
+    void run() {
+        auto l_ = std::unique_lock(lock_);
+
+        while(true) {
+            work_cv_.wait(l_, [this] { return stop_ or queued_ > 0; });
+            if(queued_ == 0) return;
+
+            auto task = std::move(ring_[head_]);
+            ring_[head_] = nullptr;
+            head_ = (head_ + 1) % ring_.size();
+            --queued_;
+
+            l_.unlock();
+            task();
+            l_.lock();
+
+            if(--outstanding_ == 0) idle_cv_.notify_all();
+        }
+    }
+
+    unsigned int thread_count_;
+    std::vector<std::thread> threads_;
+
+    std::vector<task_type> ring_;
+    std::size_t head_ = 0;
+    std::size_t queued_ = 0;
+    std::size_t outstanding_ = 0;   // queued + running
+    bool stop_ = false;
+
+    mutable std::mutex lock_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+};
+
+#endif //TASKPOOL_HPP
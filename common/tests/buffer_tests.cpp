@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <lockbuffer.hpp>
+
+
+TEST(BufferConsume, AdvancesWithoutMove) {
+    buffer b(1024);
+    b.append("0123456789", 10);
+
+    auto* base = b.data();
+    auto cap = b.capacity();
+
+    b.consume(4);
+    ASSERT_EQ(b.data(), base + 4);
+    ASSERT_EQ(b.str(), "456789");
+    ASSERT_EQ(b.headroom(), 4);
+    ASSERT_EQ(b.capacity(), cap - 4);
+
+    // emptying returns to allocation start
+    b.consume(6);
+    ASSERT_TRUE(b.empty());
+    ASSERT_EQ(b.data(), base);
+    ASSERT_EQ(b.headroom(), 0);
+    ASSERT_EQ(b.capacity(), cap);
+}
+
+TEST(BufferConsume, CapacityReusesHeadroom) {
+    buffer b(1024);
+    auto cap = b.capacity();
+    auto* base = b.data();
+
+    std::string s(cap, 'x');
+    s[cap - 1] = 'y';
+    b.append(s.data(), s.size());
+    b.consume(cap - 1);
+
+    // tail is exhausted, but headroom is enough: compact instead of reallocating
+    b.append("z", 1);
+    ASSERT_EQ(b.data(), base);
+    ASSERT_EQ(b.str(), "yz");
+    ASSERT_EQ(b.capacity(), cap);
+}
+
+TEST(BufferConsume, SwapMoveAndDetach) {
+    buffer a(256);
+    auto full = a.capacity();
+    a.append("abcdef", 6);
+    a.consume(2);
+
+    buffer b(16);
+    b.swap(a);
+    ASSERT_EQ(b.str(), "cdef");
+    ASSERT_EQ(b.headroom(), 2);
+
+    buffer c(std::move(b));
+    ASSERT_EQ(c.str(), "cdef");
+
+    auto* p = c.detach();
+    ASSERT_EQ(std::string(reinterpret_cast<char*>(p), 4), "cdef");
+    memPool::pool().release({p, full});
+}
+
+TEST(LockBufferFlush, UsesConsume) {
+    lockbuffer b(512);
+    b.append("hello world", 11);
+    auto* base = b.data();
+
+    b.flush(6);
+    ASSERT_EQ(b.data(), base + 6);
+    ASSERT_EQ(b.str(), "world");
+
+    // flush(0) keeps buffer::flush meaning: drop all
+    b.flush(0);
+    ASSERT_TRUE(b.empty());
+    ASSERT_EQ(b.data(), base);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <bufferslice.hpp>
+
+
+TEST(BufferSlice, TakeMovesMemory) {
+    buffer b(128);
+    b.append("shared data", 11);
+    auto* p = b.data();
+    auto cap = b.capacity();
+
+    auto s = buffer_slice::take(b);
+    ASSERT_EQ(s.data(), p);
+    ASSERT_EQ(s.size(), 11);
+
+    // source is reusable, with the same capacity
+    ASSERT_TRUE(b.empty());
+    ASSERT_GE(b.capacity(), cap);
+    ASSERT_NE(b.data(), p);
+}
+
+TEST(BufferSlice, CopiesShareAndConsumeIndependently) {
+    buffer b(64);
+    b.append("abcdef", 6);
+    auto s1 = buffer_slice::take(b);
+
+    auto s2 = s1;
+    ASSERT_EQ(s1.use_count(), 2);
+    ASSERT_EQ(s1.data(), s2.data());
+
+    s2.consume(2);
+    ASSERT_EQ(s1.view().str(), "abcdef");
+    ASSERT_EQ(s2.view().str(), "cdef");
+
+    auto s3 = s1.sub(1, 3);
+    ASSERT_EQ(s3.view().str(), "bcd");
+    ASSERT_EQ(s1.use_count(), 3);
+
+    s2.consume(10);
+    ASSERT_TRUE(s2.empty());
+    ASSERT_EQ(s1.use_count(), 2);
+}
+
+TEST(BufferSlice, AppendOnlyWhenUnshared) {
+    buffer_slice s("abc", 3);
+
+    {
+        auto other = s;
+        ASSERT_FALSE(s.append("d", 1));
+    }
+
+    // copy of 3 bytes may have no spare room, give it some
+    buffer b(64);
+    b.append("abc", 3);
+    auto t = buffer_slice::take(b);
+    ASSERT_TRUE(t.append("d", 1));
+    ASSERT_EQ(t.view().str(), "abcd");
+
+    // window doesn't reach the end of buffer
+    auto u = t.sub(0, 2);
+    t.reset();
+    ASSERT_FALSE(u.append("x", 1));
+}
+
+TEST(BufferSlice, ViewIsCopied) {
+    buffer b(64);
+    b.append("view", 4);
+    auto v = b.view();
+
+    auto s = buffer_slice::take(v);
+    ASSERT_NE(s.data(), b.data());
+    ASSERT_EQ(s.view().str(), "view");
+    ASSERT_EQ(b.str(), "view");
+}
@@ -0,0 +1,144 @@
+#include <cpuaffinity.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+    struct policy_guard {
+        cpu_affinity::policy_t saved = cpu_affinity::policy();
+        ~policy_guard() { cpu_affinity::policy() = saved; }
+    };
+}
+
+TEST(CpuAffinity, Parse) {
+    ASSERT_EQ(cpu_affinity::parse("compact"), cpu_affinity::policy_t::COMPACT);
+    ASSERT_EQ(cpu_affinity::parse("spread"), cpu_affinity::policy_t::SPREAD);
+    ASSERT_EQ(cpu_affinity::parse("node"), cpu_affinity::policy_t::NODE);
+    ASSERT_EQ(cpu_affinity::parse("bogus"), cpu_affinity::policy_t::NONE);
+}
+
+TEST(CpuAffinity, Slots) {
+    policy_guard g;
+    auto n = cpu_affinity::allowed_count();
+
+    cpu_affinity::policy() = cpu_affinity::policy_t::NONE;
+    ASSERT_TRUE(cpu_affinity::cpus_for(0).empty());
+    ASSERT_FALSE(cpu_affinity::apply(0));
+
+    ASSERT_EQ(cpu_affinity::worker_count(), n);
+
+    // worker slots and service slot are all allowed CPUs, each once
+    for(auto p: { cpu_affinity::policy_t::COMPACT, cpu_affinity::policy_t::SPREAD }) {
+        cpu_affinity::policy() = p;
+
+        auto workers = cpu_affinity::worker_count();
+        ASSERT_EQ(workers, n > 1 ? n - 1 : 1);
+
+        std::set<int> seen;
+        for(std::size_t i = 0; i < workers; ++i) {
+            auto c = cpu_affinity::cpus_for(i);
+            ASSERT_EQ(c.size(), 1);
+            seen.insert(c[0]);
+        }
+        ASSERT_EQ(seen.size(), workers);
+        ASSERT_EQ(cpu_affinity::cpus_for(workers), cpu_affinity::cpus_for(0));
+
+        auto service = cpu_affinity::cpus_for_service();
+        ASSERT_EQ(service.size(), 1);
+        if(n > 1) ASSERT_EQ(seen.count(service[0]), 0);
+    }
+
+    cpu_affinity::policy() = cpu_affinity::policy_t::NODE;
+    ASSERT_FALSE(cpu_affinity::cpus_for(0).empty());
+    ASSERT_LE(cpu_affinity::cpus_for(0).size(), n);
+}
+
+TEST(CpuAffinity, WorkerOfCpu) {
+    policy_guard g;
+
+    cpu_affinity::policy() = cpu_affinity::policy_t::NONE;
+    ASSERT_TRUE(cpu_affinity::worker_of_cpu(4).empty());
+
+    // each CPU maps to a worker pinned there, each worker gets its CPU
+    for(auto p: { cpu_affinity::policy_t::COMPACT, cpu_affinity::policy_t::SPREAD, cpu_affinity::policy_t::NODE }) {
+        cpu_affinity::policy() = p;
+
+        auto workers = cpu_affinity::worker_count();
+        auto by_cpu = cpu_affinity::worker_of_cpu(workers);
+        ASSERT_FALSE(by_cpu.empty());
+
+        std::set<int> mapped;
+        for(std::size_t c = 0; c < by_cpu.size(); ++c) {
+            if(by_cpu[c] < 0) continue;
+
+            ASSERT_LT(by_cpu[c], static_cast<int>(workers));
+            auto placed = cpu_affinity::cpus_for(by_cpu[c]);
+            ASSERT_NE(std::find(placed.begin(), placed.end(), static_cast<int>(c)), placed.end());
+            mapped.insert(by_cpu[c]);
+        }
+
+        if(p != cpu_affinity::policy_t::NODE) {
+            ASSERT_EQ(mapped.size(), workers);
+
+            // nobody works on service CPU
+            auto service = cpu_affinity::cpus_for_service();
+            if(cpu_affinity::allowed_count() > 1) ASSERT_EQ(by_cpu[service[0]], -1);
+        }
+    }
+}
+
+TEST(CpuAffinity, ApplyPinsThread) {
+    policy_guard g;
+    cpu_affinity::policy() = cpu_affinity::policy_t::COMPACT;
+
+    auto want = cpu_affinity::cpus_for_service();
+    ASSERT_EQ(want.size(), 1);
+
+    int count = -1;
+    bool has = false;
+    std::thread t([&] {
+        if(not cpu_affinity::apply_service()) return;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        ::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set);
+        count = CPU_COUNT(&set);
+        has = CPU_ISSET(want[0], &set);
+    });
+    t.join();
+
+    ASSERT_EQ(count, 1);
+    ASSERT_TRUE(has);
+}
+
+TEST(CpuAffinity, ServiceScopeRestoresAffinity) {
+    policy_guard g;
+    cpu_affinity::policy() = cpu_affinity::policy_t::COMPACT;
+
+    auto count = [] {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        ::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set);
+        return CPU_COUNT(&set);
+    };
+
+    int before = -1, inside = -1, after = -1;
+    std::thread t([&] {
+        before = count();
+        {
+            cpu_affinity::service_scope s;
+            inside = count();
+        }
+        after = count();
+    });
+    t.join();
+
+    ASSERT_EQ(inside, 1);
+    ASSERT_EQ(after, before);
+}
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+#include <epoll.hpp>
+#include <uring.hpp>
+
+#include <algorithm>
+
+
+TEST(ReadySet, InsertFindErase) {
+    ready_set s;
+
+    ASSERT_TRUE(s.empty());
+    ASSERT_TRUE(s.insert(5));
+    ASSERT_FALSE(s.insert(5));
+    ASSERT_TRUE(s.insert(70000));
+
+    ASSERT_TRUE(s.find(5));
+    ASSERT_TRUE(s.find(70000));
+    ASSERT_FALSE(s.find(6));
+    ASSERT_FALSE(s.find(1000000));
+    ASSERT_EQ(s.size(), 2);
+
+    ASSERT_EQ(s.erase(5), 1);
+    ASSERT_EQ(s.erase(5), 0);
+    ASSERT_FALSE(s.find(5));
+    ASSERT_TRUE(s.find(70000));
+    ASSERT_EQ(s.size(), 1);
+}
+
+TEST(ReadySet, NegativeRejected) {
+    ready_set s;
+
+    ASSERT_FALSE(s.insert(-3));
+    ASSERT_FALSE(s.find(-3));
+    ASSERT_EQ(s.erase(-3), 0);
+    ASSERT_TRUE(s.empty());
+}
+
+TEST(ReadySet, EraseKeepsListCompact) {
+    ready_set s;
+
+    for(int i = 1; i <= 100; ++i) s.insert(i);
+    for(int i = 1; i <= 100; i += 2) s.erase(i);
+
+    ASSERT_EQ(s.size(), 50);
+
+    std::vector<int> snap;
+    s.snapshot(snap);
+    std::sort(snap.begin(), snap.end());
+
+    for(std::size_t i = 0; i < snap.size(); ++i) {
+        ASSERT_EQ(snap[i], static_cast<int>(2 * (i + 1)));
+        ASSERT_TRUE(s.find(snap[i]));
+    }
+}
+
+TEST(ReadySet, Clear) {
+    ready_set s;
+
+    for(int i = 0; i < 5000; i += 7) s.insert(i);
+    s.clear();
+
+    ASSERT_TRUE(s.empty());
+    for(int i = 0; i < 5000; ++i) {
+        ASSERT_FALSE(s.find(i));
+    }
+
+    ASSERT_TRUE(s.insert(7));
+    ASSERT_EQ(s.size(), 1);
+}
+
+TEST(EpollEdgeTriggered, SingleEdgePerArrival) {
+    epoll ep;
+    ASSERT_GT(ep.init(), 0);
+    ep.edge_triggered = true;
+
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+
+    ASSERT_TRUE(ep.add(sv[0], EPOLLIN));
+    // already registered for both directions, no epoll_ctl
+    ASSERT_TRUE(ep.modify(sv[0], EPOLLIN | EPOLLOUT));
+
+    ASSERT_EQ(::write(sv[1], "abc", 3), 3);
+
+    ep.wait(100);
+    ASSERT_TRUE(ep.in_set.find(sv[0]));
+    ASSERT_TRUE(ep.out_set.find(sv[0]));
+
+    // data not consumed, but no new edge
+    ep.wait(0);
+    ASSERT_FALSE(ep.in_set.find(sv[0]));
+
+    // enforced socket is reported without an edge
+    ep.enforce_in(sv[0]);
+    ASSERT_FALSE(ep.enforced_empty());
+    ep.wait(0);
+    ASSERT_TRUE(ep.in_set.find(sv[0]));
+
+    ASSERT_TRUE(ep.del(sv[0]));
+    ASSERT_FALSE(ep.et_registered.find(sv[0]));
+
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+TEST(UringPoller, ReadinessAndRemoval) {
+    if(not uring::supported()) {
+        GTEST_SKIP() << "io_uring not supported";
+    }
+
+    uring ur;
+    ASSERT_GT(ur.init(), 0);
+    ASSERT_TRUE(ur.edge_triggered);
+
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+
+    ASSERT_TRUE(ur.add(sv[0], EPOLLIN));
+    ASSERT_TRUE(ur.modify(sv[0], EPOLLIN | EPOLLOUT));
+
+    // writable right after registration
+    ur.wait(100);
+    ASSERT_TRUE(ur.out_set.find(sv[0]));
+    ASSERT_FALSE(ur.in_set.find(sv[0]));
+
+    ASSERT_EQ(::write(sv[1], "abc", 3), 3);
+    ur.wait(100);
+    ASSERT_TRUE(ur.in_set.find(sv[0]));
+
+    // removed socket is not reported anymore
+    ASSERT_TRUE(ur.del(sv[0]));
+    ASSERT_EQ(::write(sv[1], "def", 3), 3);
+    ur.wait(50);
+    ASSERT_FALSE(ur.in_set.find(sv[0]));
+
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+TEST(UringPoller, HintSocketIsLevelTriggered) {
+    if(not uring::supported()) {
+        GTEST_SKIP() << "io_uring not supported";
+    }
+
+    uring ur;
+    ASSERT_GT(ur.init(), 0);
+
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    ASSERT_TRUE(ur.hint_socket(sv[0]));
+
+    ASSERT_EQ(::write(sv[1], "xy", 2), 2);
+
+    char c;
+    ur.wait(100);
+    ASSERT_TRUE(ur.in_set.find(sv[0]));
+    ASSERT_EQ(::read(sv[0], &c, 1), 1);
+
+    // one byte still pending, must be reported again
+    ur.wait(100);
+    ASSERT_TRUE(ur.in_set.find(sv[0]));
+
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+TEST(EpollTimers, RescanReaddsSocket) {
+    epoll e;
+    ASSERT_GE(e.init(), 0);
+
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    ASSERT_TRUE(e.add(sv[0], EPOLLIN));
+    ASSERT_EQ(::write(sv[1], "x", 1), 1);
+
+    ASSERT_TRUE(e.rescan_in(sv[0]));
+    ASSERT_FALSE(e.rescans_empty());
+
+    // socket is removed now, timers wake us up in time for the rescan
+    e.wait(5000);
+    ASSERT_FALSE(e.in_set.find(sv[0]));
+
+    auto deadline = timer_wheel<int>::clock_ms() + 2000;
+    while(not e.in_set.find(sv[0]) and timer_wheel<int>::clock_ms() < deadline) {
+        e.wait(5000);
+    }
+    ASSERT_TRUE(e.in_set.find(sv[0]));
+    ASSERT_TRUE(e.rescans_empty());
+
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+TEST(EpollTimers, IdleWatchAndDeadline) {
+    epoll e;
+    ASSERT_GE(e.init(), 0);
+    e.idle_timeout_ms = 20;
+
+    e.set_idle_watch(100);
+    e.set_idle_watch(101);
+    ASSERT_TRUE(e.in_idle_watched_set(100));
+
+    // activity cancels idle watch
+    ASSERT_EQ(e.clear_idle_watch(101), 1);
+    ASSERT_FALSE(e.in_idle_watched_set(101));
+
+    e.set_idle_deadline(-7, 30);
+
+    auto deadline = timer_wheel<int>::clock_ms() + 2000;
+    bool watched = false;
+    bool virt = false;
+    while(not (watched and virt) and timer_wheel<int>::clock_ms() < deadline) {
+        e.wait(5000);
+        watched |= e.in_idle_set(100);
+        virt |= e.in_idle_set(-7);
+        ASSERT_FALSE(e.in_idle_set(101));
+    }
+
+    ASSERT_TRUE(watched);
+    ASSERT_TRUE(virt);
+    ASSERT_EQ(e.next_timeout(), -1);
+}
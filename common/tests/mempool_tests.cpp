@@ -125,3 +125,301 @@ TEST(Mempool,MixedConcurrencyRealloc) {
 
     rinse_threads(s);
 }
+
+
+TEST(Mempool,ThreadCacheReuseAndFlush) {
+
+    auto& pool = memPool::pool();
+    memPool::tcache_flush();
+
+    auto probe = pool.acquire(1000);
+    auto* bucket = pool.find_by_address(probe.ptr);
+    ASSERT_NE(bucket, nullptr);
+    pool.release(probe);
+    memPool::tcache_flush();
+
+    auto const free_before = bucket->size();
+
+    // released chunk stays in thread magazine and comes back first
+    auto a = pool.acquire(1000);
+    pool.release(a);
+    auto b = pool.acquire(1000);
+    ASSERT_EQ(a.ptr, b.ptr);
+    pool.release(b);
+
+    // magazine took a batch from the bucket, flush returns everything
+    memPool::tcache_flush();
+    ASSERT_EQ(bucket->size(), free_before);
+}
+
+TEST(Mempool,ThreadCacheFlushOnExit) {
+
+    auto& pool = memPool::pool();
+    memPool::tcache_flush();
+
+    auto probe = pool.acquire(200);
+    auto* bucket = pool.find_by_address(probe.ptr);
+    pool.release(probe);
+    memPool::tcache_flush();
+
+    auto const free_before = bucket->size();
+
+    std::thread t([&pool] {
+        std::vector<mem_chunk_t> v;
+        for(int i = 0; i < 100; ++i) v.push_back(pool.acquire(200));
+        for(auto& c: v) pool.release(c);
+    });
+    t.join();
+
+    ASSERT_EQ(bucket->size(), free_before);
+}
+
+TEST(Mempool,BucketLockFreeConcurrency) {
+
+    auto& pool = memPool::pool();
+
+    auto probe = pool.acquire(4000);
+    auto* bucket = pool.find_by_address(probe.ptr);
+    ASSERT_NE(bucket, nullptr);
+    pool.release(probe);
+    memPool::tcache_flush();
+
+    auto const free_before = bucket->size();
+    std::atomic<int> errors = 0;
+
+    // use bucket directly, no thread cache in between
+    auto worker = [&](uint32_t id) {
+        std::vector<mem_chunk_t> held;
+        for(int i = 0; i < 20000; ++i) {
+            if(auto c = bucket->acquire(); c) {
+                std::memcpy(c->ptr + 8, &id, sizeof(id));
+                held.push_back(c.value());
+            }
+
+            if(held.size() > 8 or (not held.empty() and i % 3 == 0)) {
+                auto c = held.back();
+                held.pop_back();
+
+                // nobody else got the same chunk meanwhile
+                uint32_t check = 0;
+                std::memcpy(&check, c.ptr + 8, sizeof(check));
+                if(check != id) ++errors;
+
+                bucket->release(c);
+            }
+        }
+        for(auto& c: held) bucket->release(c);
+    };
+
+    std::vector<std::thread> threads;
+    for(uint32_t i = 0; i < 8; ++i) threads.emplace_back(worker, i + 1);
+    for(auto& t: threads) t.join();
+
+    ASSERT_EQ(errors, 0);
+    ASSERT_EQ(bucket->size(), free_before);
+}
+
+TEST(Mempool,AddressLookup) {
+
+    auto& pool = memPool::pool();
+    ASSERT_TRUE(pool.is_ready());
+
+    for(std::size_t sz: { 20, 100, 250, 900, 4000, 9000, 18000, 30000, 45000 }) {
+        auto c = pool.acquire(sz);
+        ASSERT_NE(c.ptr, nullptr);
+
+        auto* b = pool.find_by_address(c.ptr);
+        ASSERT_NE(b, nullptr);
+        ASSERT_GE(pool.find_ptr_size(c.ptr), sz);
+        ASSERT_EQ(pool.find_ptr_size(c.ptr), b->chunk_size());
+        ASSERT_EQ(pool.find_by_address(c.ptr + 1), b);   // inside the bucket range
+
+        pool.release(c);
+    }
+
+    // foreign memory is not ours
+    int on_stack = 0;
+    auto* heap = ::malloc(64);
+    ASSERT_EQ(pool.find_by_address(&on_stack), nullptr);
+    ASSERT_EQ(pool.find_by_address(heap), nullptr);
+    ASSERT_EQ(pool.find_ptr_size(heap), 0);
+    ::free(heap);
+}
+
+TEST(Mempool,ArenaFitsConfiguredMaximum) {
+
+    auto& pool = memPool::pool();
+    ASSERT_GT(pool.arena_size(), 0);
+
+    // regions are sized by the biggest bucket at its maximum, not by a fixed shift
+    std::size_t biggest = 0;
+    for(auto const* b: pool.get_buckets()) {
+        auto most = b->base_count() * (b->chunk_size() + 8) + 8;
+        if(memPool::elastic_enabled) most += memPool::elastic_max_bytes;
+        biggest = std::max(biggest, most);
+    }
+    auto const region = std::max<std::size_t>(2 * biggest, 2 * 1024 * 1024);
+    ASSERT_LE(pool.arena_size(), pool.get_buckets().size() * region);
+}
+
+TEST(Mempool,ElasticGrowAndTrim) {
+
+    auto& pool = memPool::pool();
+    ASSERT_TRUE(pool.is_ready());
+
+    auto probe = pool.acquire(45000);
+    auto* bucket = pool.find_by_address(probe.ptr);
+    ASSERT_NE(bucket, nullptr);
+    pool.release(probe);
+
+    auto const base = bucket->base_count();
+    auto const heap_before = pool.stats.heap_alloc.load();
+
+    // take more than the base, bucket must grow instead of using the heap
+    std::vector<mem_chunk_t> held;
+    for(std::size_t i = 0; i < base + base / 2; ++i) {
+        auto c = pool.acquire(45000);
+        ASSERT_EQ(c.pool_type, mem_chunk::type::POOL);
+        ASSERT_EQ(pool.find_by_address(c.ptr), bucket);
+        std::memset(c.ptr, 0xaa, c.capacity);
+        held.push_back(c);
+    }
+    ASSERT_EQ(pool.stats.heap_alloc.load(), heap_before);
+    ASSERT_GT(bucket->total_count(), base);
+
+    for(auto const& c: held) pool.release(c);
+    memPool::tcache_flush();
+    ASSERT_EQ(bucket->size(), bucket->total_count());
+
+    auto const spare = memPool::elastic_spare_slabs;
+    memPool::elastic_spare_slabs = 0;
+    ASSERT_GT(pool.trim(), 0);
+    memPool::elastic_spare_slabs = spare;
+
+    ASSERT_EQ(bucket->total_count(), base);
+    ASSERT_EQ(bucket->size(), base);
+
+    // released slabs are usable again
+    held.clear();
+    for(std::size_t i = 0; i < base + 1; ++i) {
+        auto c = pool.acquire(45000);
+        ASSERT_EQ(c.pool_type, mem_chunk::type::POOL);
+        held.push_back(c);
+    }
+    for(auto const& c: held) pool.release(c);
+    memPool::tcache_flush();
+}
+
+TEST(Mempool,LazyCarving) {
+
+    auto& pool = memPool::pool();
+    ASSERT_TRUE(pool.is_ready());
+
+    auto probe = pool.acquire(18000);
+    auto* bucket = pool.find_by_address(probe.ptr);
+    ASSERT_NE(bucket, nullptr);
+    pool.release(probe);
+    memPool::tcache_flush();
+
+    // untouched chunks are counted as available
+    ASSERT_LE(bucket->carved_count(), bucket->base_count());
+    auto const avail = bucket->size();
+    ASSERT_EQ(avail, bucket->total_count());
+
+    std::vector<mem_chunk_t> held;
+    for(int i = 0; i < 20; ++i) held.push_back(pool.acquire(18000));
+    auto const carved = bucket->carved_count();
+    ASSERT_LE(carved, bucket->base_count());
+
+    for(auto const& c: held) pool.release(c);
+    memPool::tcache_flush();
+    ASSERT_EQ(bucket->size(), avail);
+
+    // released chunks are reused before carving new ones
+    held.clear();
+    for(int i = 0; i < 20; ++i) held.push_back(pool.acquire(18000));
+    ASSERT_EQ(bucket->carved_count(), carved);
+
+    for(auto const& c: held) pool.release(c);
+    memPool::tcache_flush();
+}
+
+TEST(Mempool,SizeTable) {
+
+    auto t = memPool::parse_size_table("2048:10,100:5,2048:2,17000:3");
+    ASSERT_EQ(t.size(), 4);
+    ASSERT_TRUE(memPool::parse_size_table("2048:x").empty());
+    ASSERT_TRUE(memPool::parse_size_table("2048").empty());
+
+    // aligned, sorted and merged
+    t = memPool::normalize_size_table(t);
+    ASSERT_EQ(memPool::size_table_str(t), "112:5,2048:12,17008:3");
+
+    ASSERT_EQ(memPool::size_table_str(memPool::pool().get_size_table()),
+              memPool::size_table_str(memPool::normalize_size_table(memPool::default_size_table())));
+}
+
+TEST(Mempool,SizeHistogramSuggestion) {
+
+    using hist = memPool::size_histogram;
+    for(std::size_t s: { 1, 16, 17, 64, 65, 100, 2048, 2049, 16700, 50000, 1024 * 1024 }) {
+        auto b = hist::bin_of(s);
+        ASSERT_GE(hist::bin_upper(b), s);
+        ASSERT_EQ(hist::bin_upper(b) % 16, 0);
+        if(b > 0) ASSERT_LT(hist::bin_upper(b - 1), s);
+    }
+    ASSERT_EQ(hist::bin_of(4 * 1024 * 1024), hist::bins - 1);
+
+    auto& pool = memPool::pool();
+    pool.size_profile.reset();
+    for(int i = 0; i < 2000; ++i) pool.size_profile.record(100);
+    for(int i = 0; i < 1000; ++i) pool.size_profile.record(2048);
+    for(int i = 0; i < 500; ++i) pool.size_profile.record(16700);
+    for(int i = 0; i < 10; ++i) pool.size_profile.record(90);
+
+    auto sug = pool.suggest_size_table(3);
+    ASSERT_EQ(sug.size(), 3);
+    ASSERT_EQ(sug[0].size, 112);
+    ASSERT_EQ(sug[1].size, 2048);
+    ASSERT_EQ(sug[2].size, 20480);
+    for(auto const& cl: sug) ASSERT_GT(cl.count, 0);
+
+    // more classes than seen sizes
+    ASSERT_EQ(pool.suggest_size_table(16).size(), 4);
+    pool.size_profile.reset();
+}
+
+TEST(Mempool,NodePoolRouting) {
+
+    ASSERT_GE(memPool::node_count(), 1);
+
+    auto& local = memPool::pool();
+    ASSERT_EQ(&memPool::pool(), &local);
+    if(memPool::node_count() == 1) ASSERT_EQ(&memPool::node_pool(0), &local);
+
+    // other node's pool exists even on single node box, its memory is just not bound to a real node
+    auto& remote = memPool::node_pool(1);
+    ASSERT_NE(&remote, &local);
+    ASSERT_EQ(&memPool::node_pool(1), &remote);
+
+    auto c = remote.acquire(2000);
+    ASSERT_EQ(c.pool_type, mem_chunk::type::POOL);
+    memPool::tcache_flush();
+
+    auto* bucket = local.find_by_address(c.ptr);
+    ASSERT_NE(bucket, nullptr);
+    ASSERT_EQ(remote.find_by_address(c.ptr), bucket);
+    ASSERT_EQ(local.find_ptr_size(c.ptr), bucket->chunk_size());
+
+    // freed via local pool, goes back to the remote bucket directly
+    auto const free_before = bucket->size();
+    auto const remote_before = local.stats.remote_free.load();
+    local.release(c);
+    ASSERT_EQ(bucket->size(), free_before + 1);
+    ASSERT_EQ(local.stats.remote_free.load(), remote_before + 1);
+
+    // the same through the malloc-like API
+    auto* p = remote.acquire(100).ptr;
+    mempool_free(p);
+    ASSERT_EQ(local.stats.remote_free.load(), remote_before + 2);
+}
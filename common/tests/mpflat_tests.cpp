@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <mpstd.hpp>
+
+#include <map>
+#include <random>
+#include <string>
+
+TEST(FlatSet, SortedUniqueAndErase) {
+    mp::flat_set<int> s;
+
+    ASSERT_TRUE(s.insert(5).second);
+    ASSERT_TRUE(s.insert(-3).second);
+    ASSERT_TRUE(s.insert(10).second);
+    ASSERT_FALSE(s.insert(5).second);
+    ASSERT_EQ(s.size(), 3);
+
+    std::vector<int> seen(s.begin(), s.end());
+    ASSERT_EQ(seen, (std::vector<int>{ -3, 5, 10 }));
+
+    ASSERT_TRUE(s.contains(-3));
+    ASSERT_EQ(s.find(7), s.end());
+    ASSERT_EQ(s.erase(5), 1);
+    ASSERT_EQ(s.erase(5), 0);
+    ASSERT_EQ(s.size(), 2);
+}
+
+TEST(FlatMap, MapInterface) {
+    mp::flat_map<int, std::string> m;
+
+    m[3] = "three";
+    m[1] = "one";
+    ASSERT_TRUE(m.try_emplace(2, "two").second);
+    ASSERT_FALSE(m.try_emplace(2, "zwei").second);
+    ASSERT_EQ(m.at(2), "two");
+    ASSERT_FALSE(m.insert_or_assign(2, "dva").second);
+    ASSERT_EQ(m.at(2), "dva");
+    ASSERT_THROW(m.at(4), std::out_of_range);
+
+    int expected = 1;
+    for(auto const& [ k, v ]: m) ASSERT_EQ(k, expected++);
+
+    ASSERT_EQ(m.erase(1), 1);
+    ASSERT_EQ(m.begin()->first, 2);
+    ASSERT_EQ(m.size(), 2);
+}
+
+TEST(HashMap, AgainstStdMap) {
+    mp::hash_map<int, int> h;
+    std::map<int, int> ref;
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> key(-500, 500);
+
+    for(int i = 0; i < 50000; ++i) {
+        auto k = key(rng);
+        switch(rng() % 3) {
+            case 0:
+                h[k] = i;
+                ref[k] = i;
+                break;
+            case 1:
+                ASSERT_EQ(h.erase(k), ref.erase(k));
+                break;
+            default:
+                auto it = h.find(k);
+                auto rit = ref.find(k);
+                ASSERT_EQ(it == h.end(), rit == ref.end());
+                if(it != h.end()) {
+                    ASSERT_EQ(it->second, rit->second);
+                }
+        }
+        ASSERT_EQ(h.size(), ref.size());
+    }
+
+    std::map<int, int> copy;
+    for(auto const& [ k, v ]: h) copy[k] = v;
+    ASSERT_EQ(copy, ref);
+}
+
+TEST(HashMap, EraseWhileIterating) {
+    mp::hash_map<int, std::string> h;
+    for(int i = 0; i < 1000; ++i) h[i * 7] = std::to_string(i);
+    ASSERT_GE(h.capacity() * 3, h.size() * 4);
+
+    for(auto it = h.begin(); it != h.end(); ) {
+        if(it->first % 2 == 0) it = h.erase(it);
+        else ++it;
+    }
+
+    ASSERT_EQ(h.size(), 500);
+    for(int i = 0; i < 1000; ++i) ASSERT_EQ(h.contains(i * 7), (i * 7) % 2 != 0);
+
+    h.clear();
+    ASSERT_TRUE(h.empty());
+    ASSERT_EQ(h.begin(), h.end());
+}
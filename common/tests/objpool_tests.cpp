@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <mempool/objpool.hpp>
+
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct probe {
+        static inline int alive = 0;
+
+        explicit probe(int v) : value(v) { ++alive; }
+        ~probe() { --alive; }
+
+        int value;
+        std::string name = "probe";
+    };
+
+    struct failing {
+        explicit failing(bool fail) { if(fail) throw std::runtime_error("ctor"); }
+        long data[4] {};
+    };
+}
+
+TEST(ObjectPool, CreateDestroyReuse) {
+    auto& pool = mp::object_pool<probe>::instance();
+
+    auto* a = pool.create(1);
+    auto* b = pool.create(2);
+    ASSERT_NE(a, b);
+    ASSERT_EQ(a->value, 1);
+    ASSERT_EQ(b->value, 2);
+    ASSERT_EQ(probe::alive, 2);
+    ASSERT_EQ(pool.in_use(), 2);
+
+    pool.destroy(a);
+    ASSERT_EQ(probe::alive, 1);
+
+    // freed slot is on top of the thread's list
+    auto* c = pool.create(3);
+    ASSERT_EQ(c, a);
+
+    pool.destroy(b);
+    pool.destroy(c);
+    ASSERT_EQ(pool.in_use(), 0);
+    ASSERT_EQ(probe::alive, 0);
+}
+
+TEST(ObjectPool, ManyObjectsSlabsAndAlignment) {
+    auto& pool = mp::object_pool<probe>::instance();
+
+    std::set<probe*> seen;
+    std::vector<mp::pooled_ptr<probe>> held;
+    for(int i = 0; i < 1000; ++i) {
+        held.push_back(mp::make_pooled<probe>(i));
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(held.back().get()) % alignof(probe), 0);
+        ASSERT_TRUE(seen.insert(held.back().get()).second);
+    }
+    ASSERT_GE(pool.slabs(), 1000 / 64);
+
+    for(int i = 0; i < 1000; ++i) ASSERT_EQ(held[i]->value, i);
+
+    auto const slabs = pool.slabs();
+    held.clear();
+    ASSERT_EQ(probe::alive, 0);
+
+    // everything is reused, no new slabs
+    for(int i = 0; i < 1000; ++i) held.push_back(mp::make_pooled<probe>(i));
+    ASSERT_EQ(pool.slabs(), slabs);
+}
+
+TEST(ObjectPool, ConstructorThrows) {
+    auto& pool = mp::object_pool<failing>::instance();
+
+    ASSERT_THROW(pool.create(true), std::runtime_error);
+    ASSERT_EQ(pool.in_use(), 0);
+
+    auto* f = pool.create(false);
+    ASSERT_EQ(pool.in_use(), 1);
+    pool.destroy(f);
+}
+
+TEST(ObjectPool, SharedFromPool) {
+    auto sp = mp::make_pooled_shared<probe>(42);
+    ASSERT_EQ(sp->value, 42);
+    ASSERT_EQ(probe::alive, 1);
+
+    std::weak_ptr<probe> wp = sp;
+    auto copy = sp;
+    sp.reset();
+    ASSERT_EQ(copy->value, 42);
+
+    copy.reset();
+    ASSERT_EQ(probe::alive, 0);
+    ASSERT_TRUE(wp.expired());
+}
+
+TEST(ObjectPool, CrossThreadAndExit) {
+    auto& pool = mp::object_pool<probe>::instance();
+
+    std::vector<probe*> made(500);
+    std::thread producer([&]() {
+        for(auto& p: made) p = pool.create(7);
+    });
+    producer.join();
+
+    // freed by another thread than the one which created them
+    for(auto* p: made) pool.destroy(p);
+    ASSERT_EQ(pool.in_use(), 0);
+
+    // thread exit gives back everything it took
+    auto const before = pool.shared_free();
+    std::thread t([&]() {
+        auto* p = pool.create(1);
+        pool.destroy(p);
+    });
+    t.join();
+    ASSERT_EQ(pool.shared_free(), before);
+}
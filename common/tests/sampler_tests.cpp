@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <mempool/mempool.hpp>
+#include <buffer.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+    __attribute__((noinline)) std::vector<buffer> leaky_site(int n) {
+        std::vector<buffer> ret;
+        for(int i = 0; i < n; ++i) ret.emplace_back(4096);
+        return ret;
+    }
+
+    __attribute__((noinline)) void churn_site(int n) {
+        for(int i = 0; i < n; ++i) buffer b(4096);
+    }
+}
+
+TEST(AllocSampler, DisabledDoesNothing) {
+    alloc_sampler::reset();
+    alloc_sampler::enabled = false;
+
+    churn_site(1000);
+    ASSERT_EQ(alloc_sampler::counters().sampled.load(), 0);
+    ASSERT_TRUE(alloc_sampler::sites().empty());
+}
+
+TEST(AllocSampler, EstimatesLiveAndTotalBytes) {
+    alloc_sampler::reset();
+    alloc_sampler::sample_bytes = 64 * 1024;
+    alloc_sampler::enabled = true;
+
+    // ~40MB churned, ~20MB kept
+    churn_site(10000);
+    auto kept = leaky_site(5000);
+
+    alloc_sampler::enabled = false;
+
+    auto all = alloc_sampler::sites();
+    ASSERT_FALSE(all.empty());
+
+    unsigned long long live = 0;
+    unsigned long long total = 0;
+    for(auto const& s: all) {
+        live += s.live_bytes;
+        total += s.bytes;
+        ASSERT_FALSE(s.frames.empty());
+    }
+
+    // chunks are sampled with their real capacity, estimate within 30%
+    double live_real = 0;
+    for(auto const& b: kept) live_real += static_cast<double>(b.capacity());
+    ASSERT_GT(static_cast<double>(live), live_real * 0.7);
+    ASSERT_LT(static_cast<double>(live), live_real * 1.3);
+    ASSERT_GT(static_cast<double>(total), live_real * 3 * 0.7);
+
+    // the biggest live site is reported first
+    ASSERT_EQ(all.front().live_bytes, std::max_element(all.begin(), all.end(), [](auto const& a, auto const& b) {
+        return a.live_bytes < b.live_bytes; })->live_bytes);
+
+    auto report = alloc_sampler::dump(3);
+    ASSERT_NE(report.find("#1: live"), std::string::npos);
+
+    // releases are tracked also after the sampler is switched off
+    kept.clear();
+    live = 0;
+    for(auto const& s: alloc_sampler::sites()) live += s.live_bytes;
+    ASSERT_EQ(live, 0);
+
+    alloc_sampler::reset();
+}
+
+TEST(AllocSampler, ReleasedSamplesDoNotSlowDownLookups) {
+    alloc_sampler::reset();
+    alloc_sampler::sample_bytes = 1;
+    alloc_sampler::enabled = true;
+
+    auto fake = [](uintptr_t i) { return reinterpret_cast<void const*>(0x10000000ULL + i * 64); };
+
+    // more samples than the live table can ever hold, each one released
+    constexpr uintptr_t churned = alloc_sampler::max_live * 8;
+    for(uintptr_t i = 0; i < churned; ++i) {
+        alloc_sampler::alloc(fake(i), 64);
+        alloc_sampler::release(fake(i));
+    }
+
+    // one live sample keeps lookups active
+    alloc_sampler::alloc(fake(churned), 64);
+    alloc_sampler::enabled = false;
+    ASSERT_EQ(alloc_sampler::counters().dropped_live.load(), 0);
+
+    // not sampled pointers: with deleted entries left behind each of these would scan the whole table. Only the
+    // home slot and maybe the one live sample are visited.
+    std::size_t longest = 0;
+    for(uintptr_t i = 0; i < 100000; ++i) {
+        longest = std::max(longest, alloc_sampler::probe_length(fake(churned + 1 + i)));
+        alloc_sampler::release(fake(churned + 1 + i));
+    }
+    ASSERT_LE(longest, 2);
+
+    alloc_sampler::release(fake(churned));
+    unsigned long long live = 0;
+    for(auto const& s: alloc_sampler::sites()) live += s.live_samples;
+    ASSERT_EQ(live, 0);
+
+    alloc_sampler::sample_bytes = 512 * 1024;
+    alloc_sampler::reset();
+}
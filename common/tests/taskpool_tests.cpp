@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <taskpool.hpp>
+
+#include <atomic>
+#include <set>
+
+
+TEST(TaskPool, RunsAllTasksOnPersistentThreads) {
+    task_pool pool(3, 64);
+
+    std::atomic_int done = 0;
+    std::mutex ids_lock;
+    std::set<std::thread::id> ids;
+
+    for(int round = 0; round < 20; ++round) {
+        for(int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(pool.submit([&] {
+                {
+                    auto l_ = std::scoped_lock(ids_lock);
+                    ids.insert(std::this_thread::get_id());
+                }
+                ++done;
+            }));
+        }
+        pool.wait_idle();
+        ASSERT_EQ(done, (round + 1) * 10);
+    }
+
+    // threads are reused across rounds
+    ASSERT_LE(ids.size(), 3);
+    ASSERT_EQ(pool.outstanding(), 0);
+}
+
+TEST(TaskPool, FullQueueRejects) {
+    task_pool pool(1, 2);
+
+    std::mutex gate;
+    std::unique_lock block(gate);
+    std::atomic_bool started = false;
+
+    // occupy the only thread
+    ASSERT_TRUE(pool.submit([&] { started = true; auto l_ = std::scoped_lock(gate); }));
+    while(not started) std::this_thread::yield();
+
+    ASSERT_TRUE(pool.submit([] {}));
+    ASSERT_TRUE(pool.submit([] {}));
+    ASSERT_FALSE(pool.submit([] {}));
+
+    block.unlock();
+    pool.wait_idle();
+    ASSERT_TRUE(pool.submit([] {}));
+}
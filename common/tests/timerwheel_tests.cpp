@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <timerwheel.hpp>
+
+#include <functional>
+#include <random>
+#include <map>
+
+
+TEST(TimerWheel, ExpiresInOrder) {
+    timer_wheel<int> w(1000);
+
+    w.arm(5, 5);
+    w.arm(1, 1);
+    w.arm(300, 300);
+    w.arm(70000, 70000);
+
+    std::vector<int> fired;
+    auto cb = [&](int&& v) { fired.push_back(v); };
+
+    ASSERT_EQ(w.advance(1004, cb), 1);
+    ASSERT_EQ(w.advance(1005, cb), 1);
+    ASSERT_EQ(w.advance(1299, cb), 0);
+    ASSERT_EQ(w.advance(1300, cb), 1);
+    ASSERT_EQ(w.advance(71000, cb), 1);
+
+    ASSERT_EQ(fired, std::vector<int>({1, 5, 300, 70000}));
+    ASSERT_TRUE(w.empty());
+}
+
+TEST(TimerWheel, CancelIsIdempotent) {
+    timer_wheel<int> w(0);
+
+    auto h = w.arm(10, 1);
+    ASSERT_TRUE(w.pending(h));
+    ASSERT_TRUE(w.cancel(h));
+    ASSERT_FALSE(w.cancel(h));
+    ASSERT_FALSE(w.cancel(timer_wheel<int>::null_handle));
+
+    // node is reused, old handle must not cancel the new timer
+    auto h2 = w.arm(10, 2);
+    ASSERT_FALSE(w.cancel(h));
+    ASSERT_TRUE(w.pending(h2));
+
+    int fired = 0;
+    w.advance(100, [&](int&&) { ++fired; });
+    ASSERT_EQ(fired, 1);
+    ASSERT_FALSE(w.cancel(h2));
+}
+
+TEST(TimerWheel, NextTimeout) {
+    timer_wheel<int> w(500);
+    ASSERT_EQ(w.next_timeout(500), -1);
+
+    w.arm(20, 0);
+    ASSERT_EQ(w.next_timeout(500), 20);
+    ASSERT_EQ(w.next_timeout(515), 5);
+    ASSERT_EQ(w.next_timeout(600), 0);
+
+    // far timer: next event may be a cascade, but never later than expiry
+    timer_wheel<int> far(500);
+    far.arm(100000, 0);
+    auto t = far.next_timeout(500);
+    ASSERT_GT(t, 0);
+    ASSERT_LE(t, 100000);
+}
+
+TEST(TimerWheel, ArmAheadOfWheelTime) {
+    timer_wheel<int> w(0);
+
+    // wheel not advanced yet, but caller knows the real time
+    w.arm(10, 1, 50);
+
+    int fired = 0;
+    w.advance(59, [&](int&&) { ++fired; });
+    ASSERT_EQ(fired, 0);
+    w.advance(60, [&](int&&) { ++fired; });
+    ASSERT_EQ(fired, 1);
+}
+
+TEST(TimerWheel, CallbackMayArm) {
+    timer_wheel<int> w(0);
+    w.arm(1, 3);
+
+    std::vector<int> fired;
+    std::function<void(int&&)> cb = [&](int&& v) {
+        fired.push_back(v);
+        if(v > 1) w.arm(1, v - 1);
+    };
+
+    w.advance(10, cb);
+    ASSERT_EQ(fired, std::vector<int>({3, 2, 1}));
+}
+
+TEST(TimerWheel, RandomizedAgainstMap) {
+    std::mt19937_64 rng(42);
+    timer_wheel<int> w(12345);
+
+    uint64_t now = 12345;
+    std::multimap<uint64_t, int> expected;
+    std::map<int, timer_wheel<int>::handle_type> handles;
+    std::map<int, uint64_t> deadline;
+
+    for(int i = 0; i < 5000; ++i) {
+        uint64_t delay = 1 + rng() % (i % 3 == 0 ? 20000000 : 3000);
+        handles[i] = w.arm(delay, i);
+        deadline[i] = now + delay;
+
+        if(rng() % 4 == 0) {
+            int victim = static_cast<int>(rng() % static_cast<uint64_t>(i + 1));
+            if(w.cancel(handles[victim])) deadline.erase(victim);
+        }
+
+        if(rng() % 10 == 0) {
+            now += rng() % 5000;
+            w.advance(now, [&](int&& v) {
+                ASSERT_EQ(deadline.at(v), w.now());
+                deadline.erase(v);
+            });
+        }
+    }
+
+    w.advance(now + timer_wheel<int>::max_delay, [&](int&& v) {
+        ASSERT_EQ(deadline.at(v), w.now());
+        deadline.erase(v);
+    });
+
+    ASSERT_TRUE(deadline.empty());
+    ASSERT_TRUE(w.empty());
+}
@@ -0,0 +1,288 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/// @brief hierarchical timing wheel with 1ms resolution.
+/// There are 'levels' wheels of 256 slots each: level 0 holds timers expiring in next 256 ticks, level 1 in next 65536
+/// ticks, and so on. Timers of higher levels are cascaded down when their slot comes into range. Maximal delay is
+/// ~49 days, longer delays are clamped.
+/// Arm and cancel are O(1), advancing costs O(expired + cascaded) and skips empty ranges.
+/// Timer nodes are pooled in a vector, handles carry generation, so cancelling an already expired or cancelled timer
+/// is a harmless no-op. Not thread-safe, owner is responsible for locking.
+template <typename T>
+struct timer_wheel {
+
+    using handle_type = uint64_t;
+    using tick_type = uint64_t;
+
+    static constexpr handle_type null_handle = 0;
+
+    static constexpr unsigned int slot_bits = 8;
+    static constexpr unsigned int slots = 1U << slot_bits;
+    static constexpr unsigned int slot_mask = slots - 1;
+    static constexpr unsigned int levels = 4;
+    // keep top level expiry at most 254 slots ahead, see link()
+    static constexpr tick_type max_delay = (tick_type{1} << (slot_bits * levels)) - (tick_type{1} << (slot_bits * (levels - 1) + 1));
+
+    // monotonic milliseconds, use as 'now' argument
+    static tick_type clock_ms() {
+        return static_cast<tick_type>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    explicit timer_wheel(tick_type now = clock_ms()) : current_(now) {
+        heads_.fill(nil);
+        for(auto& l: occupied_) l.fill(0);
+    }
+
+    /// @brief arm timer expiring 'delay' ticks from wheel time (at least 1 tick)
+    handle_type arm(tick_type delay, T payload) {
+        return arm(delay, std::move(payload), current_);
+    }
+
+    /// @brief arm timer expiring 'delay' ticks from 'now', which may be ahead of wheel time (not advanced yet)
+    handle_type arm(tick_type delay, T payload, tick_type now) {
+        if(delay == 0) delay = 1;
+
+        auto expires = std::max(now, current_) + delay;
+        if(expires - current_ > max_delay) expires = current_ + max_delay;
+
+        auto idx = alloc();
+        auto& n = nodes_[idx];
+        n.expires = expires;
+        n.payload = std::move(payload);
+        n.armed = true;
+
+        link(idx);
+        ++count_;
+
+        return make_handle(idx, n.gen);
+    }
+
+    /// @brief cancel armed timer, return true if it was still pending
+    bool cancel(handle_type h) {
+        auto idx = handle_index(h);
+        if(idx >= nodes_.size()) return false;
+
+        auto& n = nodes_[idx];
+        if(not n.armed or n.gen != handle_gen(h)) return false;
+
+        unlink(idx);
+        release(idx);
+        --count_;
+
+        return true;
+    }
+
+    [[nodiscard]] bool pending(handle_type h) const {
+        auto idx = handle_index(h);
+        return idx < nodes_.size() and nodes_[idx].armed and nodes_[idx].gen == handle_gen(h);
+    }
+
+    /// @brief move time to 'now', call on_expire(T&&) for each expired timer. Return number of expired timers.
+    /// Callback may arm or cancel timers.
+    template <typename F>
+    std::size_t advance(tick_type now, F&& on_expire) {
+        std::size_t expired = 0;
+
+        while(current_ < now) {
+            if(count_ == 0) {
+                current_ = now;
+                break;
+            }
+
+            // nothing happens before next event, jump right before it
+            auto next = next_event();
+            if(next > now) {
+                current_ = now;
+                break;
+            }
+            current_ = next - 1;
+
+            expired += tick(on_expire);
+        }
+
+        return expired;
+    }
+
+    /// @brief milliseconds from 'now' to the next timer event (expiry or cascade, which could be earlier), -1 if empty
+    [[nodiscard]] long next_timeout(tick_type now) const {
+        if(count_ == 0) return -1;
+
+        auto next = next_event();
+        if(next <= now) return 0;
+
+        auto diff = next - now;
+        return diff > static_cast<tick_type>(std::numeric_limits<long>::max()) ? std::numeric_limits<long>::max()
+                                                                               : static_cast<long>(diff);
+    }
+
+    [[nodiscard]] std::size_t size() const { return count_; }
+    [[nodiscard]] bool empty() const { return count_ == 0; }
+    [[nodiscard]] tick_type now() const { return current_; }
+
+private:
+    static constexpr uint32_t nil = std::numeric_limits<uint32_t>::max();
+
+    struct node {
+        tick_type expires = 0;
+        T payload {};
+        uint32_t prev = nil;
+        uint32_t next = nil;
+        uint32_t gen = 1;
+        uint16_t slot = 0;   // level * slots + slot index
+        bool armed = false;
+    };
+
+    static handle_type make_handle(uint32_t idx, uint32_t gen) { return (static_cast<handle_type>(gen) << 32) | (idx + 1); }
+    static uint32_t handle_index(handle_type h) { return static_cast<uint32_t>(h & 0xffffffff) - 1; }
+    static uint32_t handle_gen(handle_type h) { return static_cast<uint32_t>(h >> 32); }
+
+    uint32_t alloc() {
+        if(free_ != nil) {
+            auto idx = free_;
+            free_ = nodes_[idx].next;
+            return idx;
+        }
+        nodes_.emplace_back();
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    void release(uint32_t idx) {
+        auto& n = nodes_[idx];
+        n.armed = false;
+        n.payload = T{};
+        // invalidate outstanding handles, never produce null handle
+        if(++n.gen == 0) n.gen = 1;
+
+        n.prev = nil;
+        n.next = free_;
+        free_ = idx;
+    }
+
+    // pick the lowest level where expiry falls into next 255 slots
+    void link(uint32_t idx) {
+        auto& n = nodes_[idx];
+
+        unsigned int level = 0;
+        for(; level < levels - 1; ++level) {
+            auto shift = slot_bits * level;
+            if((n.expires >> shift) - (current_ >> shift) < slots) break;
+        }
+        auto shift = slot_bits * level;
+        auto slot = static_cast<unsigned int>((n.expires >> shift) & slot_mask);
+        n.slot = static_cast<uint16_t>(level * slots + slot);
+
+        n.prev = nil;
+        n.next = heads_[n.slot];
+        if(n.next != nil) nodes_[n.next].prev = idx;
+        heads_[n.slot] = idx;
+
+        occupied_[level][slot / 64] |= uint64_t{1} << (slot % 64);
+    }
+
+    void unlink(uint32_t idx) {
+        auto& n = nodes_[idx];
+
+        if(n.prev != nil) nodes_[n.prev].next = n.next;
+        else heads_[n.slot] = n.next;
+
+        if(n.next != nil) nodes_[n.next].prev = n.prev;
+
+        if(heads_[n.slot] == nil) {
+            auto level = n.slot / slots;
+            auto slot = n.slot % slots;
+            occupied_[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+        }
+    }
+
+    // first occupied slot 1..255 positions after 'from', 0 if none
+    [[nodiscard]] unsigned int scan(unsigned int level, unsigned int from) const {
+        auto const& occ = occupied_[level];
+
+        for(unsigned int d = 1; d < slots; ) {
+            auto s = (from + d) & slot_mask;
+            auto word = occ[s / 64] >> (s % 64);
+            if(word) {
+                auto dist = d + static_cast<unsigned int>(__builtin_ctzll(word));
+                return dist < slots ? dist : 0;
+            }
+            d += 64 - (s % 64);
+        }
+        return 0;
+    }
+
+    // absolute tick of nearest expiry or cascade
+    [[nodiscard]] tick_type next_event() const {
+        auto best = std::numeric_limits<tick_type>::max();
+
+        for(unsigned int level = 0; level < levels; ++level) {
+            auto shift = slot_bits * level;
+            auto cur = current_ >> shift;
+
+            auto dist = scan(level, static_cast<unsigned int>(cur & slot_mask));
+            if(dist == 0) continue;
+
+            auto at = (cur + dist) << shift;
+            if(at < best) best = at;
+        }
+
+        return best;
+    }
+
+    template <typename F>
+    std::size_t tick(F& on_expire) {
+        ++current_;
+
+        // cascade from the highest aligned level down, entries settle in lower levels
+        unsigned int top = 0;
+        for(unsigned int level = 1; level < levels; ++level) {
+            if(current_ & ((tick_type{1} << (slot_bits * level)) - 1)) break;
+            top = level;
+        }
+        for(unsigned int level = top; level > 0; --level) {
+            auto slot = static_cast<unsigned int>((current_ >> (slot_bits * level)) & slot_mask);
+            auto at = static_cast<uint16_t>(level * slots + slot);
+
+            while(heads_[at] != nil) {
+                auto idx = heads_[at];
+                unlink(idx);
+                link(idx);
+            }
+        }
+
+        // expire; pop one by one, callback may modify the wheel
+        std::size_t expired = 0;
+        auto at = static_cast<uint16_t>(current_ & slot_mask);
+        while(heads_[at] != nil) {
+            auto idx = heads_[at];
+            unlink(idx);
+
+            T payload = std::move(nodes_[idx].payload);
+            release(idx);
+            --count_;
+            ++expired;
+
+            on_expire(std::move(payload));
+        }
+
+        return expired;
+    }
+
+    tick_type current_ = 0;
+    std::size_t count_ = 0;
+    uint32_t free_ = nil;
+
+    std::vector<node> nodes_;
+    std::array<uint32_t, levels * slots> heads_ {};
+    std::array<std::array<uint64_t, slots / 64>, levels> occupied_ {};
+};
+
+#endif //TIMERWHEEL_HPP
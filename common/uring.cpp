@@ -0,0 +1,372 @@
+#include <uring.hpp>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/time_types.h>
+
+namespace {
+    int sys_io_uring_setup(unsigned entries, io_uring_params* p) {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+    }
+
+    int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, std::size_t argsz) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+    }
+
+    // multishot poll arrived in 5.13, together with IORING_FEAT_RSRC_TAGS
+    constexpr uint32_t required_features = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+}
+
+
+bool uring::supported() {
+    static const bool is_supported = [] {
+        io_uring_params p{};
+        int s = sys_io_uring_setup(2, &p);
+        if(s < 0) return false;
+
+        ::close(s);
+        return (p.features & required_features) == required_features;
+    }();
+
+    return is_supported;
+}
+
+
+int uring::init() {
+
+    params_ = {};
+    int s = sys_io_uring_setup(URING_ENTRIES, &params_);
+    if(s < 0) {
+        _err("uring::init: io_uring_setup failed: %s", string_error().c_str());
+        return -1;
+    }
+
+    if((params_.features & required_features) != required_features) {
+        _err("uring::init: kernel lacks required io_uring features (0x%x)", params_.features);
+        ::close(s);
+        return -1;
+    }
+
+    // single mmap: both rings share one mapping
+    sq_size_ = std::max(params_.sq_off.array + params_.sq_entries * sizeof(unsigned),
+                        params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe));
+
+    sq_ptr_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s, IORING_OFF_SQ_RING);
+    if(sq_ptr_ == MAP_FAILED) {
+        _err("uring::init: cannot map rings: %s", string_error().c_str());
+        sq_ptr_ = nullptr;
+        ::close(s);
+        return -1;
+    }
+
+    sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+    auto* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) {
+        _err("uring::init: cannot map sqes: %s", string_error().c_str());
+        ::munmap(sq_ptr_, sq_size_);
+        sq_ptr_ = nullptr;
+        ::close(s);
+        return -1;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<uint8_t*>(sq_ptr_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+
+    cq_ptr_ = sq_ptr_;
+    auto* cq = static_cast<uint8_t*>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+
+    ring_fd_ = s;
+    // epoll d-tor closes it
+    epoll_fd_ = s;
+
+    _dia("uring::init: ring created: %d (sq %d, cq %d entries)", s, params_.sq_entries, params_.cq_entries);
+
+    // multishot poll is edge-triggered
+    edge_triggered = true;
+
+    return s;
+}
+
+uring::~uring() {
+    if(sqes_) ::munmap(sqes_, sqes_size_);
+    if(sq_ptr_) ::munmap(sq_ptr_, sq_size_);
+}
+
+
+uring::registration& uring::reg(int fd) {
+    auto ufd = static_cast<std::size_t>(fd);
+    if(ufd >= regs_.size()) {
+        regs_.resize(std::max(ufd + 1, regs_.size() * 2));
+    }
+    return regs_[ufd];
+}
+
+io_uring_sqe* uring::get_sqe() {
+
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail_;
+
+    if(tail - head >= params_.sq_entries) {
+        _dia("uring::get_sqe: submission ring full, flushing");
+        submit_ul();
+
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if(tail - head >= params_.sq_entries) {
+            _err("uring::get_sqe: submission ring still full");
+            return nullptr;
+        }
+    }
+
+    auto idx = tail & *sq_mask_;
+    auto* sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sq_array_[idx] = idx;
+
+    return sqe;
+}
+
+void uring::queue_poll_add(int fd, registration const& r) {
+
+    auto* sqe = get_sqe();
+    if(not sqe) return;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = r.mask;
+    sqe->len = r.oneshot ? 0 : IORING_POLL_ADD_MULTI;
+    sqe->user_data = user_data(fd, r.gen);
+
+    __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+    ++sq_pending_;
+}
+
+void uring::queue_poll_remove(int fd, registration const& r) {
+
+    auto* sqe = get_sqe();
+    if(not sqe) return;
+
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = user_data(fd, r.gen);
+    sqe->user_data = UD_INTERNAL;
+
+    __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+    ++sq_pending_;
+}
+
+int uring::enter(unsigned int to_submit, unsigned int wait_nr, long timeout_ms) {
+
+    unsigned flags = 0;
+    io_uring_getevents_arg arg{};
+    __kernel_timespec ts{};
+    void* argp = nullptr;
+    std::size_t argsz = 0;
+
+    if(wait_nr > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+
+        if(timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+    }
+
+    int r = sys_io_uring_enter(ring_fd_, to_submit, wait_nr, flags, argp, argsz);
+    if(r < 0) {
+        // timeout or signal is not an error
+        if(errno == ETIME or errno == EINTR) return 0;
+
+        _err("uring::enter: io_uring_enter failed %d: %s", errno, string_error().c_str());
+    }
+
+    return r;
+}
+
+int uring::submit_ul() {
+    auto to_submit = sq_pending_;
+    sq_pending_ = 0;
+
+    return enter(to_submit, 0, 0);
+}
+
+
+bool uring::add(int socket, int mask) {
+
+    if(socket < 0) return false;
+
+    auto l_ = std::scoped_lock(sq_lock_);
+
+    auto& r = reg(socket);
+    if(r.mask != 0) {
+        _ext("uring:add:%x: socket %d already added", this, socket);
+        return true;
+    }
+
+    r.gen++;
+    r.oneshot = (socket == hint_socket());
+    r.mask = static_cast<uint32_t>(effective_mask(socket, mask));
+
+    queue_poll_add(socket, r);
+
+    if(edge_triggered and not r.oneshot) {
+        et_registered.insert(socket);
+    }
+    _deb("uring:add:%x: socket %d queued, mask 0x%x", this, socket, r.mask);
+
+    // someone sleeps in the ring, don't wait for the next loop turn
+    if(waiting_) {
+        submit_ul();
+    }
+
+    return true;
+}
+
+bool uring::modify(int socket, int mask) {
+
+    {
+        auto l_ = std::scoped_lock(sq_lock_);
+        if(socket >= 0 and reg(socket).mask != 0) {
+            _ext("uring:modify:%x: socket %d edge-triggered, nothing to modify", this, socket);
+            return true;
+        }
+    }
+
+    _dia("uring:modify:%x: socket %d not monitored, fixing...", this, socket);
+    add(socket, mask);
+    return false;
+}
+
+bool uring::del(int socket) {
+
+    if(socket < 0) return false;
+
+    auto l_ = std::scoped_lock(sq_lock_);
+
+    auto& r = reg(socket);
+    et_registered.erase(socket);
+
+    if(r.mask == 0) {
+        return false;
+    }
+
+    queue_poll_remove(socket, r);
+
+    // completions of the removed request are stale from now on
+    r.mask = 0;
+    r.gen++;
+
+    _deb("uring:del:%x: socket %d removal queued", this, socket);
+
+    if(waiting_) {
+        submit_ul();
+    }
+
+    return true;
+}
+
+
+int uring::reap_completions() {
+
+    auto l_ = std::scoped_lock(sq_lock_);
+
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+    int n = 0;
+    while(head != tail and n < EPOLLER_MAX_EVENTS) {
+        auto const& cqe = cqes_[head & *cq_mask_];
+        ++head;
+
+        if(cqe.user_data & UD_INTERNAL) continue;
+
+        int fd = ud_fd(cqe.user_data);
+        auto& r = reg(fd);
+
+        if(r.mask == 0 or r.gen != ud_gen(cqe.user_data)) {
+            _ext("uring::reap: stale completion for socket %d", fd);
+            continue;
+        }
+
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+
+        if(cqe.res < 0) {
+            if(cqe.res != -ECANCELED) {
+                _dia("uring::reap: socket %d poll error: %s", fd, string_error(-cqe.res).c_str());
+                events[n].events = EPOLLERR;
+                events[n].data.fd = fd;
+                ++n;
+
+                // don't re-arm failing socket
+                r.mask = 0;
+                r.gen++;
+                et_registered.erase(fd);
+                continue;
+            }
+        }
+        else {
+            events[n].events = static_cast<uint32_t>(cqe.res);
+            events[n].data.fd = fd;
+            ++n;
+        }
+
+        // oneshot or terminated multishot request: arm again
+        if(r.oneshot or not more) {
+            queue_poll_add(fd, r);
+        }
+    }
+
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+int uring::poll_events(long timeout) {
+
+    unsigned int pending = 0;
+    {
+        auto l_ = std::scoped_lock(sq_lock_);
+        pending = sq_pending_;
+        sq_pending_ = 0;
+        waiting_ = true;
+    }
+
+    // submit queued registrations and wait for completions in one syscall
+    int r = enter(pending, 1, timeout);
+    waiting_ = false;
+
+    if(r < 0) {
+        return -1;
+    }
+
+    int nfds = 0;
+    int cur_nfds = 0;
+    unsigned count = 0;
+    do {
+        cur_nfds = reap_completions();
+        nfds += cur_nfds;
+
+        _if_deb {
+            _debug_sockets(cur_nfds);
+        }
+
+        int proc = process_epoll_events(cur_nfds);
+        _deb("uring::wait: processed %d from %d ready sockets - round %d", proc, nfds, count);
+
+        count++;
+    } while (cur_nfds == EPOLLER_MAX_EVENTS);
+
+    return nfds;
+}
@@ -0,0 +1,94 @@
+#ifndef URING_HPP
+#define URING_HPP
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+#include <epoll.hpp>
+
+/*
+ * io_uring based poller backend. It's a drop-in replacement of struct epoll: sets, rescans, idle detection and
+ * enforcing are inherited, only registration and waiting for events are done differently.
+ *
+ * Sockets are monitored with multishot IORING_OP_POLL_ADD requests. Multishot poll reports readiness changes only,
+ * therefore this backend always runs in edge-triggered mode (see epoll::edge_triggered). Exception is the hint socket,
+ * which is polled with oneshot request re-armed after each completion - giving it level-triggered behaviour.
+ *
+ * Registrations are only queued into submission ring and submitted together with waiting for completions, so
+ * in the common case there is a single io_uring_enter() syscall per event loop turn.
+ *
+ * Requires kernel with multishot poll and IORING_FEAT_EXT_ARG (5.13+). Use uring::supported() to check.
+ */
+struct uring : public epoll {
+
+    static constexpr unsigned int URING_ENTRIES = 1024;
+
+    int init() override;
+    int poll_events(long timeout) override;
+
+    bool add(int socket, int mask) override;
+    bool modify(int socket, int mask) override;
+    bool del(int socket) override;
+
+    /// @brief probe if kernel supports everything we need
+    static bool supported();
+
+    ~uring() override;
+
+private:
+    // user_data layout: [ 63: internal | 62-32: generation | 31-0: fd ]
+    static constexpr uint64_t UD_INTERNAL = 1ULL << 63;
+    static inline uint64_t user_data(int fd, uint32_t gen) { return (static_cast<uint64_t>(gen & 0x7fffffff) << 32) | static_cast<uint32_t>(fd); }
+    static inline int ud_fd(uint64_t ud) { return static_cast<int>(ud & 0xffffffff); }
+    static inline uint32_t ud_gen(uint64_t ud) { return static_cast<uint32_t>((ud >> 32) & 0x7fffffff); }
+
+    // per-fd registration state, indexed by fd
+    struct registration {
+        uint32_t gen = 0;
+        uint32_t mask = 0;     // 0 means not registered
+        bool oneshot = false;
+    };
+    std::vector<registration> regs_;
+    registration& reg(int fd);
+
+    // queue poll requests, submitted in next poll_events() (or immediately if ring is full or someone waits)
+    io_uring_sqe* get_sqe();
+    void queue_poll_add(int fd, registration const& r);
+    void queue_poll_remove(int fd, registration const& r);
+    int submit_ul();
+    int enter(unsigned int to_submit, unsigned int wait_nr, long timeout_ms);
+
+    int reap_completions();
+
+    int ring_fd_ = -1;
+    io_uring_params params_ {};
+
+    // submission ring
+    void* sq_ptr_ = nullptr;
+    std::size_t sq_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqes_size_ = 0;
+    unsigned int sq_pending_ = 0;
+
+    // completion ring, mapped together with submission ring (sq_ptr_)
+    void* cq_ptr_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+
+    // submission queue is shared with threads modifying our sockets
+    std::mutex sq_lock_;
+    std::atomic_bool waiting_ = false;
+
+    logan_lite log = logan_lite("com.uring");
+};
+
+#endif //URING_HPP
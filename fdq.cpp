@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <array>
 #include <unistd.h>
+#include <sys/eventfd.h>
 #include <sys/fcntl.h>
 
 #include <fdq.hpp>
+#include <baseproxy.hpp>
 
 #define USE_SOCKETPAIR
 
@@ -14,8 +18,14 @@ std::pair<int, int> FdQueue::new_pair(uint32_t id) {
 
     auto l_ = std::scoped_lock(get_lock());
 
+    if(auto efd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC); efd >= 0) {
+        _inf("acceptor: using eventfd");
+        sq_type_ = sq_type_t::SQ_EVENTFD;
+        hint_pair[0] = efd;
+        hint_pair[1] = efd;
+    }
 #ifdef USE_SOCKETPAIR
-    if(0 == ::socketpair(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK, 0, hint_pair)) {
+    else if(0 == ::socketpair(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK, 0, hint_pair)) {
         _inf("acceptor: using socketpair");
         sq_type_ = sq_type_t::SQ_SOCKETPAIR;
     }
@@ -25,7 +35,7 @@ std::pair<int, int> FdQueue::new_pair(uint32_t id) {
     }
 
 #else
-    if(version_check(get_kernel_version(),"3.4")) {
+    else if(version_check(get_kernel_version(),"3.4")) {
         _deb("Acceptor: kernel supports O_DIRECT");
         if ( 0 != pipe2(hint_pair,O_DIRECT|O_NONBLOCK)) {
             _err("ThreadAcceptor::new_raw: hint pipe not created, error[%d], %s", errno, string_error().c_str());
@@ -39,7 +49,7 @@ std::pair<int, int> FdQueue::new_pair(uint32_t id) {
 #endif
 
     auto pa = std::make_pair(hint_pair[0], hint_pair[1]);
-    hint_pairs_[id] = WorkerPipe(pa);
+    hint_pairs_[id] = WorkerPipe(pa, worker_queue_size);
 
     return pa;
 }
@@ -55,8 +65,9 @@ int FdQueue::close_all() {
 
         auto const& worker_pipe = pair.second;
 
-       ::close(worker_pipe.pipe_to_scheduler());
-        ::close(worker_pipe.pipe_to_worker());
+        ::close(worker_pipe.pipe_to_scheduler());
+        if(worker_pipe.pipe_to_worker() != worker_pipe.pipe_to_scheduler())
+            ::close(worker_pipe.pipe_to_worker());
 
         s++;
     });
@@ -72,58 +83,123 @@ const char* FdQueue::sq_type_str() const {
             return "pipe";
         case sq_type_t::SQ_SOCKETPAIR:
             return "socketpair";
+        case sq_type_t::SQ_EVENTFD:
+            return "eventfd";
     }
     return "unknown";
 }
 
+namespace {
+    // cheap per-thread generator for power-of-two-choices
+    uint32_t pick_random() {
+        static thread_local uint32_t state = 0x9e3779b9u ^ static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state));
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
 std::size_t FdQueue::push_all(int s) {
+    return push_batch(&s, 1);
+}
 
-    {
+std::size_t FdQueue::push_batch(int const* socks, std::size_t count) {
+
+    auto const n = hint_pairs_.size();
+
+    if(n == 0) {
         auto lc_ = std::scoped_lock(sq_lock_);
-        sq_.push_front(s);
+        for(std::size_t i = 0; i < count; ++i) sq_.push_front(socks[i]);
+        sq_size_ += count;
+        return 0;
     }
 
-    uint64_t entry_count = 0;
-    uint64_t written_sum = 0;
+    // workers to wake up after the whole batch is queued
+    std::array<WorkerPipe*, 16> touched {};
+    std::size_t touched_count = 0;
 
-    auto write_to_socket = [this](auto sock) {
-        auto wr = ::write(sock, "A", 1);
-        if (wr <= 0) {
-            _err("FdQueue::push: failed to write hint byte - socket[%d] error[%d]: %s", sock, wr,
-                 string_error().c_str());
-            return 0;
-        } else {
-            return 1;
+    for(std::size_t i = 0; i < count; ++i) {
+        auto const s = socks[i];
+
+        // power of two choices: less loaded of two random workers
+        auto chosen = hint_pairs_.begin() + pick_random() % n;
+        if(n > 1) {
+            auto other = hint_pairs_.begin() + pick_random() % n;
+            if(other->second.seen_worker_load.load() < chosen->second.seen_worker_load.load()) chosen = other;
         }
-    };
 
-    std::multimap<uint64_t, WorkerPipe const*> candidates;
+        auto& target = chosen->second;
 
-    for(auto const& [ key, pipes ]: hint_pairs_) {
-        ++entry_count;
-        candidates.insert(std::pair(pipes.seen_worker_load.load(), &pipes));
+        if(not target.queue or not target.queue->push(s)) {
+            _deb("FdQueue::push: worker %d queue full, socket %d goes to overflow", chosen->first, s);
+            auto lc_ = std::scoped_lock(sq_lock_);
+            sq_.push_front(s);
+            ++sq_size_;
+        }
 
-        _deb("FdQueue::push: candidate with load %d inserted", pipes.seen_worker_load.load());
+        // account for it until worker reports its real load, so a burst is not sent all to the same worker
+        target.seen_worker_load++;
+
+        _deb("FdQueue::push: socket %d to worker %d (load %d)", s, chosen->first, target.seen_worker_load.load());
+
+        auto const end = touched.begin() + touched_count;
+        if(std::find(touched.begin(), end, &target) == end) {
+            if(touched_count < touched.size()) touched[touched_count++] = &target;
+            else wakeup(target);
+        }
     }
 
-    for(auto const& candy: candidates) {
-        ++written_sum;
-        if(written_sum > entry_count/2) break;
+    for(std::size_t i = 0; i < touched_count; ++i) wakeup(*touched[i]);
 
-        _deb("FdQueue::push: candidate with load %d summoned", candy.second->seen_worker_load.load());
-        auto sock = candy.second->pipe_to_worker();
-        written_sum += write_to_socket(sock);
+    return touched_count;
+}
 
-        // mechanism to help further avoid spurious wake-ups.
-        // if reported from worker, we stop notifying the rest.
-        if(WorkerPipe::feedback_queue_empty) {
-            _deb("FdQueue::push: feedback - queue is already empty");
-            WorkerPipe::feedback_queue_empty = false;
-            break;
-        }
+void FdQueue::wakeup(WorkerPipe& wp) {
+
+    // pairs with the fence in clear_wakeup(): either we see worker's cleared flag, or it sees our queued work
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(wp.signalled.exchange(true)) {
+        ++counters_.wakeups_coalesced;
+        return;
+    }
+    ++counters_.wakeups;
+
+    ssize_t wr = 0;
+    if(sq_type_ == sq_type_t::SQ_EVENTFD) {
+        uint64_t one = 1;
+        wr = ::write(wp.pipe_to_worker(), &one, sizeof(one));
+    } else {
+        wr = ::write(wp.pipe_to_worker(), "A", 1);
     }
 
-    return entry_count;
+    if (wr <= 0) {
+        _err("FdQueue::wakeup: failed to signal - socket[%d] error[%d]: %s", wp.pipe_to_worker(), wr,
+             string_error().c_str());
+        wp.signalled = false;
+    }
+}
+
+void FdQueue::clear_wakeup(WorkerPipe& wp) {
+
+    if(sq_type_ == sq_type_t::SQ_EVENTFD) {
+        uint64_t cnt = 0;
+        auto red = ::read(wp.pipe_to_scheduler(), &cnt, sizeof(cnt));
+        _dia("FdQueue::clear_wakeup: read %d, counter %d", red, cnt);
+    } else {
+        char buf[64];
+        while(::read(wp.pipe_to_scheduler(), buf, sizeof(buf)) == sizeof(buf)) {}
+    }
+
+    wp.signalled = false;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // producer could skip signalling while the flag was still set
+    if(pending(wp)) wakeup(wp);
+}
+
+bool FdQueue::pending(WorkerPipe const& wp) const {
+    return (wp.queue and wp.queue->size() > 0) or sq_size_.load(std::memory_order_relaxed) > 0;
 }
 
 void FdQueue::update_load(uint32_t worker_id, uint32_t load) {
@@ -133,51 +209,118 @@ void FdQueue::update_load(uint32_t worker_id, uint32_t load) {
      }
 }
 
+std::optional<int> FdQueue::pop_overflow() {
+
+    if(sq_size_.load(std::memory_order_relaxed) == 0) return std::nullopt;
+
+    auto lc_ = std::scoped_lock(sq_lock_);
+    if (sq_.empty()) return std::nullopt;
+
+    int ret = sq_.back();
+    sq_.pop_back();
+    --sq_size_;
+
+    return ret;
+}
+
 int FdQueue::pop(uint32_t worker_id) {
 
-    ssize_t red = 0;
-    char dummy_buffer[1];
+    auto it = hint_pairs_.find(worker_id);
+    if(it == hint_pairs_.end()) {
+        throw fdqueue_error("hints out of bounds");
+    }
 
-    int returned_socket = 0;
+    auto& wp = it->second;
 
-    {
+    std::optional<int> ret;
+    if(wp.queue) ret = wp.queue->pop();
+    if(not ret) ret = pop_overflow();
 
-        // if we have hint-pair for each worker, we should read out hint message to not make a loop
-        // because nobody else than us won't.
-        try {
-            red = ::read(hint_pairs_[worker_id].pipe_to_scheduler(), dummy_buffer, 1);
-        } catch (std::out_of_range const&) {
-            throw fdqueue_error("hints out of bounds");
-        }
+    // wakeup channel stays readable while there is more work, so we are called again; one wakeup covers all of it
+    if(wp.signalled.load() and not pending(wp)) {
+        clear_wakeup(wp);
+    }
 
-        auto lc_ = std::scoped_lock(sq_lock_);
+    return ret.value_or(0);
+}
 
-        if (sq_.empty()) {
+std::size_t FdQueue::queued(uint32_t worker_id) const {
+    auto it = hint_pairs_.find(worker_id);
+    if(it == hint_pairs_.end() or not it->second.queue) return 0;
 
-            // report to scheduler queue is empty. It's not required, but it's nice from us.
-            WorkerPipe::feedback_queue_empty = true;
-            return 0;
-        }
-        else {
+    return it->second.queue->size();
+}
+
+std::pair<int,int> FdQueue::hint_pair(uint32_t id) const {
+    return hint_pairs_.at(id).pipe;
+}
+
+
+bool FdQueue::request_steal(uint32_t thief_id) {
 
-            returned_socket = sq_.back();
-            sq_.pop_back();
+    auto me = hint_pairs_.find(thief_id);
+    if(me == hint_pairs_.end()) return false;
 
-            // do another check and report to scheduler
-            if (sq_.empty()) {
-                WorkerPipe::feedback_queue_empty = true;
-            }
+    auto my_load = me->second.seen_worker_load.load();
+
+    std::optional<worker_id_t> victim;
+    uint32_t victim_load = 0;
+    for(auto const& [ id, pipes ]: hint_pairs_) {
+        auto load = pipes.seen_worker_load.load();
+        if(id != thief_id and load > victim_load) {
+            victim = id;
+            victim_load = load;
         }
     }
 
-    if(red > 0) {
-        _dia("FdQueue::pop: clearing sq__hint %c", dummy_buffer[0]);
-    } else {
-        _dia("FdQueue::pop_for_worker: hint not read, read returned %d", red);
+    if(not victim or victim_load < my_load + steal_threshold) return false;
+
+    auto count = std::min((victim_load - my_load) / 2, steal_batch_max);
+
+    auto l_ = std::scoped_lock(steal_lock_);
+    steal_requests_[victim.value()] = { thief_id, count };
+
+    _dia("FdQueue::request_steal: worker %d (load %d) asks worker %d (load %d) for %d proxies", thief_id, my_load,
+         victim.value(), victim_load, count);
+    return true;
+}
+
+std::optional<std::pair<uint32_t, uint32_t>> FdQueue::steal_request(uint32_t victim_id) {
+
+    auto l_ = std::scoped_lock(steal_lock_);
+
+    auto it = steal_requests_.find(victim_id);
+    if(it == steal_requests_.end()) return std::nullopt;
+
+    auto ret = it->second;
+    steal_requests_.erase(it);
+
+    return ret;
+}
+
+void FdQueue::hand_over(uint32_t thief_id, std::unique_ptr<baseProxy> proxy) {
+
+    {
+        auto l_ = std::scoped_lock(steal_lock_);
+        handed_over_[thief_id].emplace_back(std::move(proxy));
+    }
+
+    // wake up thief the same way as for new sockets
+    auto it = hint_pairs_.find(thief_id);
+    if(it != hint_pairs_.end()) {
+        wakeup(it->second);
     }
-    return returned_socket;
 }
 
-std::pair<int,int> FdQueue::hint_pair(uint32_t id) const {
-    return hint_pairs_.at(id).pipe;
-}
\ No newline at end of file
+std::vector<std::unique_ptr<baseProxy>> FdQueue::take_over(uint32_t thief_id) {
+
+    auto l_ = std::scoped_lock(steal_lock_);
+
+    auto it = handed_over_.find(thief_id);
+    if(it == handed_over_.end()) return {};
+
+    auto ret = std::move(it->second);
+    handed_over_.erase(it);
+
+    return ret;
+}
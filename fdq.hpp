@@ -19,40 +19,125 @@
 #ifndef FDQUEUE_HPP
 #define FDQUEUE_HPP
 
+#include <atomic>
 #include <tuple>
 #include <optional>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include <log/logan.hpp>
 #include <mpstd.hpp>
 
+class baseProxy;
+
+
+/// @brief bounded lock-free MPSC queue of sockets (sequence-numbered cells). Capacity is rounded up to power of two.
+struct fd_ring {
+
+    explicit fd_ring(std::size_t capacity) {
+        std::size_t cap = 2;
+        while(cap < capacity) cap <<= 1;
+
+        cells_ = std::vector<cell>(cap);
+        for(std::size_t i = 0; i < cap; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+        mask_ = cap - 1;
+    }
+
+    // any thread
+    bool push(int fd) {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        while(true) {
+            auto& c = cells_[pos & mask_];
+            auto seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if(diff == 0) {
+                if(tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.fd = fd;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(diff < 0) {
+                return false;   // full
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // owning worker only
+    std::optional<int> pop() {
+        auto pos = head_.load(std::memory_order_relaxed);
+        auto& c = cells_[pos & mask_];
+        if(c.seq.load(std::memory_order_acquire) != pos + 1) return std::nullopt;
+
+        int fd = c.fd;
+        c.seq.store(pos + mask_ + 1, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return fd;
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        auto t = tail_.load(std::memory_order_relaxed);
+        auto h = head_.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+    [[nodiscard]] std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct cell {
+        std::atomic<std::size_t> seq {0};
+        int fd = 0;
+    };
+
+    std::vector<cell> cells_;
+    std::size_t mask_ = 0;
+    alignas(64) std::atomic<std::size_t> tail_ {0};
+    alignas(64) std::atomic<std::size_t> head_ {0};
+};
+
 
 struct WorkerPipe {
 
     using fd_pair_t = std::pair<int,int>;
 
-    explicit WorkerPipe(fd_pair_t const& p): pipe(p){};
+    WorkerPipe(fd_pair_t const& p, std::size_t queue_size): pipe(p), queue(std::make_shared<fd_ring>(queue_size)) {};
     WorkerPipe() = default;
 
-    WorkerPipe(WorkerPipe const& other) : pipe(other.pipe), seen_worker_load(other.seen_worker_load.load()) {};
+    WorkerPipe(WorkerPipe const& other) : pipe(other.pipe), queue(other.queue),
+                                          seen_worker_load(other.seen_worker_load.load()),
+                                          signalled(other.signalled.load()) {};
     WorkerPipe& operator=(WorkerPipe& ref) noexcept {
         pipe = ref.pipe;
+        queue = ref.queue;
         seen_worker_load = ref.seen_worker_load.load();
+        signalled = ref.signalled.load();
         return *this;
     }
     WorkerPipe& operator=(WorkerPipe&& ref) noexcept {
         pipe = ref.pipe;
+        queue = std::move(ref.queue);
         seen_worker_load = ref.seen_worker_load.load();
+        signalled = ref.signalled.load();
         return *this;
     }
 
-    // pair of sockets used to talk between scheduler and worker.
-    // scheduler sends one byte whenever wants to wake up worker to pick from task queue.
+    // wakeup channel between scheduler and worker: eventfd (both ends are the same fd), or socketpair/pipe
+    // if eventfd is not available. Worker monitors it, scheduler signals it when it queues work.
     fd_pair_t pipe = { -1, -1 };
     inline int pipe_to_scheduler() const noexcept { return  pipe.first; }
     inline int pipe_to_worker() const noexcept { return pipe.second; }
 
+    // sockets handed to this worker. Shared, so the ring stays in place when hint_pairs_ storage moves.
+    std::shared_ptr<fd_ring> queue;
+
     std::atomic_uint32_t seen_worker_load = 0;
-    static inline std::atomic_bool feedback_queue_empty = false;
+
+    // wakeup is pending and not consumed by the worker yet - further ones are not needed
+    std::atomic_bool signalled = false;
 };
 
 class FdQueue {
@@ -61,12 +146,14 @@ public:
     FdQueue();
     virtual ~FdQueue();
 
-    enum  class sq_type_t { SQ_PIPE = 0, SQ_SOCKETPAIR = 1 };
+    enum  class sq_type_t { SQ_PIPE = 0, SQ_SOCKETPAIR = 1, SQ_EVENTFD = 2 };
     sq_type_t sq_type() const { return sq_type_; }
     const char* sq_type_str() const;
 
     int close_all();
     std::size_t push_all(int s);
+    // place each socket to a worker, wake up every chosen worker once. @return number of workers chosen.
+    std::size_t push_batch(int const* socks, std::size_t count);
 
     void update_load(uint32_t worker_id, uint32_t load);
     int pop(uint32_t worker_id);
@@ -78,21 +165,64 @@ public:
     std::mutex& get_lock() const { return sq_lock_; }
     std::atomic_uint32_t& worker_id_max() { return worker_id_max_; }
 
+    // per-worker queue capacity; sockets not fitting go to the shared overflow queue
+    static inline std::size_t worker_queue_size = 4096;
+    [[nodiscard]] std::size_t queued(uint32_t worker_id) const;
+    [[nodiscard]] std::size_t overflow_size() const { return sq_size_.load(std::memory_order_relaxed); }
+
+    // wakeup syscalls done vs. skipped because the worker was signalled already
+    [[nodiscard]] unsigned long long wakeups() const { return counters_.wakeups; }
+    [[nodiscard]] unsigned long long wakeups_coalesced() const { return counters_.wakeups_coalesced; }
+
+    // work stealing: worker with load lower by at least steal_threshold than the most loaded one asks it to hand over
+    // (half of the difference, at most steal_batch_max) sub-proxies. Loads are those reported by update_load().
+    static inline uint32_t steal_threshold = 8;
+    static inline uint32_t steal_batch_max = 16;
+
+    bool request_steal(uint32_t thief_id);
+    // victim side: consume request, return thief id and proxy count
+    std::optional<std::pair<uint32_t, uint32_t>> steal_request(uint32_t victim_id);
+    // victim side: pass released proxy to the thief and wake it up
+    void hand_over(uint32_t thief_id, std::unique_ptr<baseProxy> proxy);
+    // thief side: collect proxies handed over
+    std::vector<std::unique_ptr<baseProxy>> take_over(uint32_t thief_id);
+
 private:
 
     // pipe created to be monitored by Workers with poll. If pipe is filled with *some* data
     // there is something in the queue to pick-up.
 
 
-    sq_type_t sq_type_ = sq_type_t::SQ_SOCKETPAIR;
+    sq_type_t sq_type_ = sq_type_t::SQ_EVENTFD;
+
+    // signal worker unless it has a wakeup pending already
+    void wakeup(WorkerPipe& wp);
+    // worker side: consume pending wakeup, re-signal if work arrived meanwhile
+    void clear_wakeup(WorkerPipe& wp);
+    [[nodiscard]] bool pending(WorkerPipe const& wp) const;
 
+    struct counters_t {
+        std::atomic<unsigned long long> wakeups {0};
+        std::atomic<unsigned long long> wakeups_coalesced {0};
+    };
+    counters_t counters_;
+
+    // overflow: used only if chosen worker's queue is full, or there are no workers yet
     mutable std::mutex sq_lock_;
     mp::deque<int> sq_;
+    std::atomic<std::size_t> sq_size_ = 0;
+
+    std::optional<int> pop_overflow();
 
     std::atomic_uint32_t worker_id_max_ = 0;
 
     using worker_id_t = unsigned int;
-    mp::map<worker_id_t, WorkerPipe> hint_pairs_;
+    mp::flat_map<worker_id_t, WorkerPipe> hint_pairs_;
+
+    std::mutex steal_lock_;
+    // victim -> (thief, count)
+    std::map<worker_id_t, std::pair<uint32_t, uint32_t>> steal_requests_;
+    std::map<worker_id_t, std::vector<std::unique_ptr<baseProxy>>> handed_over_;
 
     logan_lite log;
 
@@ -111,6 +241,7 @@ std::optional<int> FdQueue::pop_if(UnaryPredicate check_true) {
     uint32_t val = sq_.back();
     if(check_true(val)) {
         sq_.pop_back();
+        --sq_size_;
         return val;
     }
 
@@ -151,6 +282,13 @@ struct FdQueueHandler {
         throw fdqueue_error("handler: no fdqueue");
     }
 
+    std::size_t hint_push_batch(int const* socks, std::size_t count) const {
+        if(fdqueue)
+            return fdqueue->push_batch(socks, count);
+
+        throw fdqueue_error("handler: no fdqueue");
+    }
+
     [[nodiscard]] FdQueue::sq_type_t hint_sq_type() const {
         if(fdqueue)
             return fdqueue->sq_type();
@@ -194,6 +332,36 @@ struct FdQueueHandler {
         throw fdqueue_error("handler: no fdqueue");
     }
 
+    bool request_steal(uint32_t thief_id) const {
+        if(fdqueue)
+            return fdqueue->request_steal(thief_id);
+
+        throw fdqueue_error("handler: no fdqueue");
+    }
+
+    [[nodiscard]] std::optional<std::pair<uint32_t, uint32_t>> steal_request(uint32_t victim_id) const {
+        if(fdqueue)
+            return fdqueue->steal_request(victim_id);
+
+        throw fdqueue_error("handler: no fdqueue");
+    }
+
+    void hand_over(uint32_t thief_id, std::unique_ptr<baseProxy> proxy) const {
+        if(fdqueue) {
+            fdqueue->hand_over(thief_id, std::move(proxy));
+            return;
+        }
+
+        throw fdqueue_error("handler: no fdqueue");
+    }
+
+    [[nodiscard]] std::vector<std::unique_ptr<baseProxy>> take_over(uint32_t thief_id) const {
+        if(fdqueue)
+            return fdqueue->take_over(thief_id);
+
+        throw fdqueue_error("handler: no fdqueue");
+    }
+
 private:
     std::shared_ptr<FdQueue> fdqueue;
 };
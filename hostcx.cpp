@@ -24,6 +24,8 @@
 
 
 #include <number.hpp>
+#include <algorithm>
+#include <array>
 using namespace socle::raw;
 
 namespace std
@@ -138,6 +140,14 @@ bool baseHostCX::opening_timeout() {
 }
 
 
+void baseHostCX::arm_deadline() {
+    if(socket() == 0) return;
+
+    auto left = deadline() - time(nullptr);
+    com()->set_idle_deadline(socket(), std::max<long>(left, 1L) * 1000L);
+}
+
+
 bool baseHostCX::idle_timeout() const {
     time_t now = time(nullptr);
     bool read_timeout = false;
@@ -395,6 +405,32 @@ void baseHostCX::after_read(std::size_t buffer_written_len) {
 
 }
 
+void baseHostCX::after_spliced_read(std::size_t bytes) {
+    meter_read_bytes += bytes;
+    meter_read_count++;
+    r_activity = time(nullptr);
+
+    // spliced data never reach readbuf, they are not subject of processing
+    processed_in_total_ += bytes;
+
+    if (opening()) {
+        _dia("baseHostCX::after_spliced_read[%s]: connection established", c_type());
+        opening(false);
+    }
+}
+
+void baseHostCX::after_spliced_write(std::size_t bytes) {
+    meter_write_bytes += bytes;
+    meter_write_count++;
+    w_activity = time(nullptr);
+    processed_out_total_ += bytes;
+
+    if (opening()) {
+        _deb("baseHostCX::after_spliced_write[%s]: connection established", c_type());
+        opening(false);
+    }
+}
+
 int baseHostCX::read() {
 
     if(io_disabled()) {
@@ -406,7 +442,7 @@ int baseHostCX::read() {
         return -1;
     }
 
-    if(peer() && peer()->writebuf()->size() > baseHostCX::params_t::write_full) {
+    if(peer() && peer()->write_pending() > baseHostCX::params_t::write_full) {
         _deb("baseHostCX::read[%d]: deferring read operation",socket());
         com()->rescan_read(socket());
         return -1;
@@ -418,8 +454,15 @@ int baseHostCX::read() {
     _dum("HostCX::read[%s]: calling pre_read",c_type());
     pre_read();
 
+    // in edge-triggered mode we must drain the socket, or tell poller data are still pending
+    bool const edge_triggered = com()->edge_triggered();
+
     if(read_eagain()) {
         read_unlimited();
+
+        if(edge_triggered) {
+            com()->rescan_read(socket());
+        }
         return -1;
     }
 
@@ -435,6 +478,11 @@ int baseHostCX::read() {
 
     while(true) {
 
+        // no room behind data: reclaim space consumed in front before reading
+        if(readbuf_.size() >= readbuf_.capacity() and readbuf_.headroom() > 0) {
+            readbuf_.compact();
+        }
+
         // append-like behavior: append to the end of the buffer, don't exceed max. capacity!
         void *cur_read_ptr = &(readbuf_.data()[readbuf_.size()]);
 
@@ -481,6 +529,10 @@ int baseHostCX::read() {
         if(this_read_op_limit > 0 and buffer_written_len >= static_cast<ssize_t>(this_read_op_limit))
         {
             _dia("baseHostCX::read[%s]: read limiter hit on %d bytes.", c_type(), buffer_written_len);
+
+            if(edge_triggered) {
+                com()->set_enforce(socket());
+            }
             break;
         }
 
@@ -494,8 +546,17 @@ int baseHostCX::read() {
             grow_buffer();
         }
 
-        // reaching code here means that we don't want other iterations
-        break;
+        // level-triggered: reaching code here means that we don't want other iterations
+        if(not edge_triggered) {
+            break;
+        }
+
+        // edge-triggered: read again until EAGAIN, unless buffer cannot take more data
+        if(readbuf_.size() >= readbuf_.capacity()) {
+            _dia("baseHostCX::read[%s]: buffer full, socket not drained - enforcing next read", c_type());
+            com()->set_enforce(socket());
+            break;
+        }
 
     }
 
@@ -562,6 +623,11 @@ int baseHostCX::write() {
 
     auto acc = std::scoped_lock(*writebuf());
 
+    // writebuf_ goes first, chain is written once it's empty
+    if(writebuf_.empty() and not write_chain_.empty()) {
+        return write_chain_out();
+    }
+
     // pre-write operation
 
     auto tx_size_orig = writebuf_.size();
@@ -594,8 +660,21 @@ int baseHostCX::write() {
         }
     }
 
+    bool const edge_triggered = com()->edge_triggered();
+
     // process_out can actually extend bytes, so we cannot rely on tx_size
-    ssize_t l = io_write(writebuf_.data(), std::min(writebuf_.size(), processed_out_), MSG_NOSIGNAL);
+    auto const to_send = std::min(writebuf_.size(), processed_out_);
+    ssize_t l = io_write(writebuf_.data(), to_send, MSG_NOSIGNAL);
+
+    // edge-triggered: keep writing until all is sent or socket would block (next EPOLLOUT edge will follow)
+    if(edge_triggered) {
+        while(l > 0 and static_cast<std::size_t>(l) < to_send) {
+            auto cur_l = io_write(writebuf_.data() + l, to_send - static_cast<std::size_t>(l), MSG_NOSIGNAL);
+            if(cur_l <= 0) break;
+
+            l += cur_l;
+        }
+    }
 
     if (l > 0) {
         meter_write_bytes += static_cast<std::size_t>(l);
@@ -623,7 +702,7 @@ int baseHostCX::write() {
             com()->set_write_monitor(socket());
             rescan_out_flag_ = true;
 
-        } else {
+        } else if(write_chain_.empty()) {
             // write buffer is empty
             if(rescan_out_flag_) {
                 rescan_out_flag_ = false;
@@ -640,7 +719,7 @@ int baseHostCX::write() {
                     socle::tools::crc32::compute(0, writebuf()->data(), writebuf()->size()));
         }
 
-        if(close_after_write() && writebuf()->empty()) {
+        if(close_after_write() && write_pending() == 0) {
             shutdown();
         }
     }
@@ -649,8 +728,10 @@ int baseHostCX::write() {
         _dia("baseHostCX::write[%s]: %d bytes written out of %d -> setting socket write monitor",
                 c_type(), l, writebuf_.size());
 
-        // write was not successful, wait a while
-        com()->rescan_write(socket());
+        // write was not successful, wait a while (edge-triggered socket will get EPOLLOUT edge once writable)
+        if(not edge_triggered) {
+            com()->rescan_write(socket());
+        }
         rescan_out_flag_ = true;
     }
     else if(l < 0) {
@@ -661,6 +742,106 @@ int baseHostCX::write() {
 }
 
 
+int baseHostCX::write_chain_out() {
+
+    bool const edge_triggered = com()->edge_triggered();
+    ssize_t l = 0;
+
+    while(not write_chain_.empty()) {
+        std::array<iovec, 1024> iov{};
+        auto const iov_max = std::clamp(params_t::write_chain_iov, 1, static_cast<int>(iov.size()));
+
+        int cnt = 0;
+        std::size_t batch = 0;
+        for(auto& chunk: write_chain_) {
+            if(cnt >= iov_max) break;
+
+            iov[cnt].iov_base = const_cast<unsigned char*>(chunk.data());
+            iov[cnt].iov_len = chunk.size();
+            batch += chunk.size();
+            ++cnt;
+        }
+
+        auto cur_l = com()->writev(socket(), iov.data(), cnt, MSG_NOSIGNAL);
+        if(cur_l <= 0) {
+            if(l == 0) l = cur_l;
+            break;
+        }
+        l += cur_l;
+
+        // drop written chunks, the last one may be written partially
+        auto left = static_cast<std::size_t>(cur_l);
+        while(left > 0) {
+            auto& front = write_chain_.front();
+            if(left < front.size()) {
+                front.consume(left);
+                write_chain_bytes_ -= left;
+                break;
+            }
+            left -= front.size();
+            write_chain_bytes_ -= front.size();
+            write_chain_.pop_front();
+        }
+
+        // level-triggered: one attempt per round; edge-triggered: until socket would block
+        if(not edge_triggered or static_cast<std::size_t>(cur_l) < batch) break;
+    }
+
+    if (l > 0) {
+        meter_write_bytes += static_cast<std::size_t>(l);
+        meter_write_count++;
+        w_activity = time(nullptr);
+        // chained data are not processed, don't let write() think it has seen data in writebuf
+        processed_out_total_ += static_cast<std::size_t>(l);
+
+        if (opening()) {
+            _deb("baseHostCX::write_chain_out[%s]: connection established", c_type());
+            opening(false);
+        }
+        _deb("baseHostCX::write_chain_out[%s]: %d bytes sent, %d bytes in %d chunks pending", c_type(), l,
+             write_chain_bytes_, write_chain_.size());
+
+        if(not write_chain_.empty()) {
+            com()->set_write_monitor(socket());
+            rescan_out_flag_ = true;
+        }
+        else if(rescan_out_flag_) {
+            rescan_out_flag_ = false;
+            com()->change_monitor(socket(), EPOLLIN);
+        }
+
+        if(close_after_write() && write_pending() == 0) {
+            shutdown();
+        }
+    }
+    else if(l == 0) {
+        _dia("baseHostCX::write_chain_out[%s]: nothing written, %d bytes pending", c_type(), write_chain_bytes_);
+
+        if(not edge_triggered) {
+            com()->rescan_write(socket());
+        }
+        rescan_out_flag_ = true;
+    }
+    else {
+        _dia("baseHostCX::write_chain_out[%s] write failed: %s, unrecoverable.", c_type(), string_error().c_str());
+    }
+
+    return down_cast<int>(l).value_or(max_of<int>());
+}
+
+void baseHostCX::write_chain_append(const void* data, std::size_t len) {
+    if(len == 0) return;
+
+    // small writes are copied into the last chunk if it has room
+    if(not write_chain_.empty() and write_chain_.back().append(data, len)) {
+        write_chain_bytes_ += len;
+        return;
+    }
+
+    write_chain_.emplace_back(data, len);
+    write_chain_bytes_ += len;
+}
+
 void baseHostCX::pre_write() {
 }
 
@@ -706,6 +887,18 @@ lockbuffer& baseHostCX::to_read() {
 
 void baseHostCX::to_write(buffer& b) {
 
+    if(write_chain() and not b.empty()) {
+        // take over the memory, caller gets new buffer of the same capacity
+        auto chunk = buffer_slice::take(b);
+
+        write_chain_bytes_ += chunk.size();
+        write_chain_.emplace_back(std::move(chunk));
+        _deb("baseHostCX::to_write(buf)[%s]: chained %d bytes, %d bytes pending", c_type(), write_chain_.back().size(), write_pending());
+
+        com()->set_write_monitor(socket());
+        return;
+    }
+
     bool fastlane = false;
     if(writebuf()->empty()) {
         if(meter_write_bytes > params_t::fast_copy_start) {
@@ -735,8 +928,32 @@ void baseHostCX::to_write(buffer& b) {
     com()->set_write_monitor(socket());
 }
 
+void baseHostCX::to_write(buffer_slice const& s) {
+
+    if(s.empty()) return;
+
+    if(write_chain() or not write_chain_.empty()) {
+        write_chain_bytes_ += s.size();
+        write_chain_.push_back(s);
+        _deb("baseHostCX::to_write(slice)[%s]: chained %d shared bytes, %d bytes pending", c_type(), s.size(), write_pending());
+    }
+    else {
+        writebuf_.append(s.data(), s.size());
+        _deb("baseHostCX::to_write(slice)[%s]: appending %d bytes, buffer size now %d bytes", c_type(), s.size(), writebuf_.size());
+    }
+
+    com()->set_write_monitor(socket());
+}
+
 void baseHostCX::to_write(const std::string& s) {
 
+    // keep ordering: once chain is used, everything goes there
+    if(not write_chain_.empty()) {
+        write_chain_append(s.data(), s.size());
+        com()->set_write_monitor(socket());
+        return;
+    }
+
     writebuf_.append(s.data(), s.size());
     com()->set_write_monitor(socket());
     _deb("baseHostCX::to_write(ptr)[%s]: appending %d bytes, buffer size now %d bytes", c_type(), s.size(), writebuf_.size());
@@ -744,6 +961,12 @@ void baseHostCX::to_write(const std::string& s) {
 }
 
 void baseHostCX::to_write(unsigned char* c, unsigned int l) {
+    if(not write_chain_.empty()) {
+        write_chain_append(c, l);
+        com()->set_write_monitor(socket());
+        return;
+    }
+
     writebuf_.append(c,l);
     com()->set_write_monitor(socket());
     _deb("baseHostCX::to_write(ptr)[%s]: appending %d bytes, buffer size now %d bytes", c_type(), l, writebuf_.size());
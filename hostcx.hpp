@@ -20,6 +20,7 @@
 #define HOSTCX_HPP
 
 #include <string>
+#include <deque>
 #include <ctime>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -32,6 +33,7 @@
 #include <basecom.hpp>
 #include <log/logger.hpp>
 #include <lockbuffer.hpp>
+#include <bufferslice.hpp>
 #include <display.hpp>
 
 
@@ -187,6 +189,8 @@ public:
         static inline std::atomic<std::size_t> write_full = 200000;    // when to slightly delay our reads if this bytes is queued from their writing
         static inline uint16_t com_not_ready_slowdown = 20;            // when handshakes are not finished, how aggressive checking (higher, more aggressive)
         static inline std::atomic<std::size_t> fast_copy_start = 20*1024;      // how many bytes copy before moving whole buffers (too low may break detection)
+        static inline std::atomic<bool> write_chain = false;             // default for new cx, see write_chain()
+        static inline int write_chain_iov = 64;                          // max chunks in one writev()
     };
 
     static inline params_t params {};
@@ -226,6 +230,11 @@ private:
 	
 	lockbuffer readbuf_;  //!< read buffer
 	lockbuffer writebuf_; //!< write buffer
+
+	// chunks queued behind writebuf_, taken over from to_write() callers (or shared) and written with one writev()
+	std::deque<buffer_slice> write_chain_;
+	std::size_t write_chain_bytes_ = 0L;
+	bool write_chain_enabled_ = params_t::write_chain;
 	
 	std::size_t processed_in_total_ = 0L;
 	std::size_t processed_out_total_ = 0L;
@@ -342,12 +351,18 @@ public:
     [[maybe_unused]] inline std::size_t processed_out() const noexcept { return processed_out_; };
 
 	inline bool opening() const { return opening_; }
-	inline void opening(bool b) { opening_ = b;
+	inline void opening(bool b) {
+        bool opened = opening_ and not b;
+        opening_ = b;
         if (b) {
             t_connected = time(nullptr);
             w_activity = t_connected;
             r_activity = t_connected;
         }
+        // connection timeout no longer applies
+        else if (opened and parent_proxy()) {
+            arm_deadline();
+        }
     }
 	// if we are trying to open socket too long - effective for non-blocking sockets only
 	bool opening_timeout();
@@ -404,8 +419,15 @@ public:
 	int connect();
 	bool reconnect();
 	inline int reconnect_delay() const { return reconnect_delay_; }
+    inline void reconnect_delay(unsigned short d) { reconnect_delay_ = d; };
 	inline int idle_delay() const { return idle_delay_; };
     inline void idle_delay(unsigned short d) { idle_delay_ = d; };
+    // time after which idle_timeout() starts to be true, unless there is an activity
+    inline time_t idle_deadline() const { return std::max(w_activity, r_activity) + idle_delay() + 1; };
+    // time after which opening_timeout() is true if still opening, idle_deadline() otherwise
+    inline time_t deadline() const { return opening() ? t_connected + reconnect_delay() + 1 : idle_deadline(); };
+    // arm poller deadline(), poller then reports the socket to the parent proxy (in idle set) when it's due
+    void arm_deadline();
     
 	inline bool should_reconnect_now() const { time_t now = time(nullptr); return (now - last_reconnect_ > reconnect_delay() && !reduced()); }
 	
@@ -415,7 +437,7 @@ public:
 	inline lockbuffer* writebuf() { return &writebuf_; }
     inline lockbuffer const* writebuf() const { return &readbuf_; }
 	
-	inline void send(buffer& b) { writebuf_.append(b); }
+	inline void send(buffer& b) { if(write_chain_.empty()) writebuf_.append(b); else write_chain_append(b.data(), b.size()); }
 	inline std::size_t peek(buffer& b) const
     {
         auto r = com()->peek(this->socket(), b.data(), b.capacity(), 0);
@@ -453,10 +475,16 @@ public:
 	ssize_t io_read(void* where, size_t len, int flags) const;
 	void after_read(std::size_t bytes);
 
+	// metering of bytes moved by splice(), bypassing read/write buffers
+	void after_spliced_read(std::size_t bytes);
+	void after_spliced_write(std::size_t bytes);
+
 	std::size_t process_in_();
     std::size_t process_out_();
 	int write();
 	ssize_t io_write(unsigned char* data, size_t tx_size, int flags) const;
+	int write_chain_out();
+	void write_chain_append(const void* data, std::size_t len);
 	
 	
 	//overide this, and return number of bytes to be possible to passed to application/another hostcx
@@ -466,7 +494,18 @@ public:
 
 	virtual void to_write(buffer& b);
     virtual void to_write(const std::string&);
-	virtual void to_write(unsigned char* c, unsigned int l); 
+	virtual void to_write(unsigned char* c, unsigned int l);
+	// shared data: queued without copy in write chain mode, copied to writebuf_ otherwise. Sharing saves memory
+	// only if all receivers have write chain enabled.
+	virtual void to_write(buffer_slice const& s); 
+	/*! write chain mode: to_write(buffer&) takes over buffer memory instead of copying it into writebuf_. Chunks
+	 *  are queued after writebuf_ and written out together with writev(), bypassing pre_write() and process_out().
+	 *  Don't enable it for cx which modify or inspect outgoing data. */
+	inline bool write_chain() const { return write_chain_enabled_; };
+	inline void write_chain(bool b) { write_chain_enabled_ = b; };
+	// bytes waiting to be written, writebuf_ and write chain
+	inline std::size_t write_pending() const { return writebuf_.size() + write_chain_bytes_; };
+
 	inline bool close_after_write() const { return close_after_write_; };
 	inline void close_after_write(bool b) { close_after_write_ = b; };
 	
@@ -17,12 +17,35 @@
 */
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <string>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <typeinfo>
 
 #include <baseproxy.hpp>
 #include <lrproxy.hpp>
+#include <tcpcom.hpp>
+#include <uxcom.hpp>
+
+namespace {
+    // one slice is shared only if every peer queues it as is (write chain), otherwise each peer copies it anyway
+    // and taking over the read buffer would cost an extra allocation
+    template<typename Peers, typename PcPeers>
+    bool share_slice(Peers const& peers, PcPeers const& pc_peers) {
+        if(peers.size() + pc_peers.size() < 2) return false;
+
+        auto chained = [](auto const* cx) { return cx->write_chain(); };
+        return std::all_of(peers.begin(), peers.end(), chained)
+               and std::all_of(pc_peers.begin(), pc_peers.end(), chained);
+    }
+
+    // to_write(buffer&) may take the buffer over (fastlane swap, write chain), only the last peer can get it
+    void copy_to(baseHostCX* peer, buffer& b, bool last) {
+        if(last) peer->to_write(b);
+        else peer->to_write(b.data(), b.size());
+    }
+}
 
 SimpleLRProxy::SimpleLRProxy(baseCom* c) : baseProxy(c) {
 }
@@ -30,16 +53,28 @@ SimpleLRProxy::SimpleLRProxy(baseCom* c) : baseProxy(c) {
 void SimpleLRProxy::on_left_bytes(baseHostCX* left) {
 	_deb("LRProxy::on_left_bytes[%d]",left->socket());
 
+	if(share_slice(right_sockets, right_pc_cx)) {
+		// fan-out: all peers share the received bytes
+		auto slice = buffer_slice::take(left->to_read());
+		_deb("LRProxy::on_left_bytes[%d]: sharing %d bytes", left->socket(), slice.size());
+
+		for(auto j: right_sockets) { j->to_write(slice); }
+		for(auto j: right_pc_cx) { j->to_write(slice); }
+
+		left->finish();
+		return;
+	}
 	
+	auto peers = right_sockets.size() + right_pc_cx.size();
 	for(auto j: right_sockets) {
 		//move from left read buffer -> right write buffer
 		_deb("LRProxy::on_left_bytes[%d]: copying into socket %d, size %d", left->socket(), j->socket(), left->readbuf()->size());
-		j->to_write(left->to_read());
+		copy_to(j, left->to_read(), --peers == 0);
 	}
 	for(auto j : right_pc_cx) {
 		_deb("LRProxy::on_left_bytes[%d]: copying into pc socket %d, size %d", left->socket(), j->socket(), left->readbuf()->size());
 		//move from left read buffer -> right write buffer
-		j->to_write(left->to_read());
+		copy_to(j, left->to_read(), --peers == 0);
 	}	
 	
 	// move away copied data from left read buffer -> they were processed and now even copied to another side
@@ -48,18 +83,66 @@ void SimpleLRProxy::on_left_bytes(baseHostCX* left) {
 
 void SimpleLRProxy::on_right_bytes(baseHostCX* right) {
 	_deb("LRProxy::on_right_bytes[%d]",right->socket());
+
+	if(share_slice(left_sockets, left_pc_cx)) {
+		// fan-out: all peers share the received bytes
+		auto slice = buffer_slice::take(right->to_read());
+		_deb("LRProxy::on_right_bytes[%d]: sharing %d bytes", right->socket(), slice.size());
+
+		for(auto j: left_sockets) { j->to_write(slice); }
+		for(auto j: left_pc_cx) { j->to_write(slice); }
+
+		right->finish();
+		return;
+	}
+
+	auto peers = left_sockets.size() + left_pc_cx.size();
 	for(auto j : left_sockets) {
 		// move from right read buffer -> left write buffer
 		_deb("LRProxy::on_right_bytes[%d]: copying into socket %d, size %d", right->socket(), j->socket(), right->readbuf()->size());
-		j->to_write(right->to_read());
+		copy_to(j, right->to_read(), --peers == 0);
 	}
 	for(auto j : left_pc_cx) {
 		// move from right read buffer -> left write buffer
 		_deb("LRProxy::on_right_bytes[%d]: copying into pc socket %d, size %d", right->socket(), j->socket(), right->readbuf()->size());
-		j->to_write(right->to_read());
+		copy_to(j, right->to_read(), --peers == 0);
 	}
 	
 	// move away copied data from left read buffer -> they were processed and now even copied to another side
 	right->finish();
 }
 
+
+namespace {
+    // exact type match: derived coms (ie. SSL) transform the stream
+    bool spliceable(baseHostCX const* cx) {
+        if(not cx or not cx->com() or cx->socket() <= 0) return false;
+
+        auto const& c = *cx->com();
+        return typeid(c) == typeid(TCPCom) or typeid(c) == typeid(UxCom);
+    }
+}
+
+baseHostCX* SimpleLRProxy::splice_peer(unsigned char side, baseHostCX* cx) {
+
+    if(not zero_copy) return nullptr;
+
+    // only 1:1 pairs, data would have to be duplicated otherwise
+    if(left_sockets.size() + left_pc_cx.size() != 1 or right_sockets.size() + right_pc_cx.size() != 1) return nullptr;
+
+    baseHostCX* peer = nullptr;
+    if(side == 'l' or side == 'x') {
+        peer = right_sockets.empty() ? right_pc_cx.front() : right_sockets.front();
+    } else {
+        peer = left_sockets.empty() ? left_pc_cx.front() : left_sockets.front();
+    }
+
+    if(not spliceable(cx) or not spliceable(peer)) return nullptr;
+
+    // buffered data must go first
+    if(not cx->readbuf()->empty() or peer->write_pending() > 0) return nullptr;
+    if(cx->read_waiting_for_peercom() or peer->write_waiting_for_peercom()) return nullptr;
+    if(cx->io_disabled() or peer->io_disabled()) return nullptr;
+
+    return peer;
+}
@@ -29,9 +29,18 @@ class SimpleLRProxy: public baseProxy {
 	public:
 		explicit SimpleLRProxy(baseCom* c);
 		
+		// with more peers on the other side, received bytes are shared by all of them (buffer_slice) if every
+		// peer has write_chain() enabled, otherwise each peer gets its copy
 		void on_left_bytes(baseHostCX*) override;
 		void on_right_bytes(baseHostCX*) override;
 
+		// forward plain TCP/unix stream pairs with splice(), without copying through buffers
+		static inline bool zero_copy_default = false;
+		bool zero_copy = zero_copy_default;
+
+protected:
+		baseHostCX* splice_peer(unsigned char side, baseHostCX* cx) override;
+
 private:
     logan_lite log {"proxy"};
 
@@ -28,7 +28,7 @@ int MasterProxy::prepare_sockets(baseCom* xcom)
     int r = 0;
     
     r += baseProxy::prepare_sockets(xcom);
-    for(auto& [ p, thr ]: proxies()) {
+    for(auto& p: proxies()) {
         if(p && not p->state().dead()) {
             r += p->prepare_sockets(xcom); // fill my fd_sets!
         }
@@ -37,62 +37,15 @@ int MasterProxy::prepare_sockets(baseCom* xcom)
     return r;
 }
 
-bool MasterProxy::run_timers()
-{
-    if(baseProxy::run_timers()) {
-
-        auto delit_list = std::vector<baseProxy*>();
-
-        for(auto i = proxies().begin(); i != proxies().end(); ) {
-
-            auto const& p = i->first;
-
-            if(not p) {
-                _inf("null sub-proxy!!");
-                continue;
-            }
-
-            if(p->state().dead() and not p->state().in_progress()) {
-                {
-                    auto l_ = std::scoped_lock(proxies_lock_);
-                    auto& thr = i->second;
-
-                    if(thread_finish(thr)) {
-                        _deb("MasterProxy::run_timers: finished handle thread");
-                    }
-
-                    auto lcx = logan_context(p->to_string(iNOT));
-                    i = proxies().erase(i);
-                }
-                continue;
-            } else {
-                auto lcx = logan_context(p->to_string(iNOT));
-                p->run_timers();
-            }
-
-            ++i;
-        }
-
-        return true;
-    }
-
-    return false;
-}
+task_pool& MasterProxy::spray_pool() {
+    if(not spray_pool_) {
+        auto threads = subproxy_pool_threads > 0 ? subproxy_pool_threads : std::thread::hardware_concurrency();
+        spray_pool_ = std::make_unique<task_pool>(threads, subproxy_pool_queue);
 
-
-bool MasterProxy::thread_finish(std::unique_ptr<std::thread>& thread_ptr) {
-    bool ret = false;
-
-    if(thread_ptr) {
-        if(thread_ptr->joinable()) {
-            thread_ptr->join();
-        }
-
-        thread_ptr.reset();
-        ret = true;
+        _dia("MasterProxy::spray_pool: %d threads, queue %d", spray_pool_->thread_count(), spray_pool_->capacity());
     }
 
-    return ret;
+    return *spray_pool_;
 }
 
 int MasterProxy::handle_sockets_once(baseCom* xcom) {
@@ -118,7 +71,7 @@ int MasterProxy::handle_sockets_once(baseCom* xcom) {
     auto proxies_sz = proxies().size();
 
     std::size_t proxy_idx = 0;
-    for(auto& [ proxy, thr ] : proxies()) {
+    for(auto& proxy : proxies()) {
 
         if(state().dead()) {
             proxy->state().dead(true);
@@ -129,15 +82,14 @@ int MasterProxy::handle_sockets_once(baseCom* xcom) {
                 
         if (not proxy->state().dead()) {
 
-            auto run_proxy = [this, xcom](baseProxy* p) {
+            // 'claimed' proxy has in_progress already set by us
+            auto run_proxy = [this, xcom](baseProxy* p, bool claimed) {
                 auto lcx = logan_context(p->to_string(iNOT));
 
-                try {
-                    if(p->state().in_progress().fetch_add(1) == 0) {
-                        p->handle_sockets_once(xcom);
+                if(not claimed and p->state().in_progress().fetch_add(1) != 0) return;
 
-                        p->state().in_progress().store(0);
-                    }
+                try {
+                    p->handle_sockets_once(xcom);
                 }
                 catch (socle::com_error const &e) {
                     _err("slave proxy exception: %s", e.what());
@@ -147,6 +99,8 @@ int MasterProxy::handle_sockets_once(baseCom* xcom) {
                     _err("slave proxy exception: %s", e.what());
                     p->state().dead(true);
                 }
+
+                p->state().in_progress().store(0);
             };
 
             r++;
@@ -156,18 +110,22 @@ int MasterProxy::handle_sockets_once(baseCom* xcom) {
 
                 _deb("proxy spray for: %s", proxy->to_string(iINF).c_str());
 
-                // we know it's not in progress from condition at the start of the loop
-                if(thread_finish(thr)) {
-                    _deb("MasterProxy::handle_sockets_once: run-phase finished handle thread");
-                }
+                // claim it now: until the task is finished, proxy is neither handled again nor removed
+                proxy->state().in_progress().store(1);
 
+                auto* p = proxy.get();
+                if(not spray_pool().submit([run_proxy, p] { run_proxy(p, true); })) {
+                    _deb("MasterProxy::handle_sockets_once: spray queue full, running in place");
 
-                thr = std::make_unique<std::thread>(run_proxy, proxy.get());
+                    auto pref = logan_lite::context();
+                    run_proxy(p, true);
+                    logan_lite::context(pref);
+                }
 
             } else {
 
                 auto pref = logan_lite::context();
-                run_proxy(proxy.get());
+                run_proxy(proxy.get(), false);
                 logan_lite::context(pref);
             }
         }
@@ -175,10 +133,14 @@ int MasterProxy::handle_sockets_once(baseCom* xcom) {
         ++proxy_idx;
     }
 
+    // sub-proxies share poller sets with us, don't continue until they are done with this round
+    if(spray_pool_) {
+        spray_pool_->wait_idle();
+    }
+
     for(auto i = proxies().begin(); i != proxies().end(); ) {
 
-        auto const& proxy = i->first;
-        auto& thr = i->second;
+        auto const& proxy = *i;
 
         if(not proxy) {
             i = proxies().erase(i);
@@ -186,13 +148,7 @@ int MasterProxy::handle_sockets_once(baseCom* xcom) {
         }
 
         // assert in_progress state
-        if(proxy->state().in_progress()) continue;
-
-        // we know it's not in progress anymore
-        if(thread_finish(thr)) {
-            _deb("MasterProxy::handle_sockets_once: cleanup-phase finished handle thread");
-        }
-
+        if(proxy->state().in_progress()) { ++i; continue; }
 
         if (proxy->state().dead()) {
 
@@ -222,19 +178,18 @@ void MasterProxy::shutdown() {
 	
 	int i = 0;
 
+    // let sprayed sub-proxies finish
+    if(spray_pool_) {
+        _deb("MasterProxy::shutdown: waiting for %d running sub-proxies", spray_pool_->outstanding());
+        spray_pool_->wait_idle();
+    }
+
 	// anyone getting proxies from list would get valid pointer
 	auto l_ = std::scoped_lock(proxies_lock_);
 
-	for(auto& [ proxy, thr ] : proxies()) {
+	for(auto& proxy : proxies()) {
 		_inf("MasterProxy::shutdown: slave[%d]",i);
 
-        if(thr and thr->joinable()) {
-            _deb("MasterProxy::shutdown: slave[%d]: joining handler thread",i);
-            thr->join();
-            thr.reset();
-            _dia("MasterProxy::shutdown: slave[%d]: joined",i);
-        }
-
         if(proxy) {
             proxy->shutdown();
         }
@@ -255,7 +210,7 @@ std::string MasterProxy::hr() {
         ss << "Slaves:\n";
 		
 		int i = 0;
-		for(auto const& [ proxy, thr ]: proxies()) {
+		for(auto const& proxy: proxies()) {
 			
             ss << "slave-" + std::to_string(i) + ":\n";
             ss << proxy->hr();
@@ -21,6 +21,7 @@
 #define MASTERPROXY_H
 
 #include <baseproxy.hpp>
+#include <taskpool.hpp>
 
 class MasterProxy : public baseProxy {
 
@@ -29,7 +30,8 @@ public:
     using vector_type = mp::vector<T>;
     template<class T>
     using set_type = mp::set<T>;
-    using proxy_entry = std::pair<std::unique_ptr<baseProxy>,std::unique_ptr<std::thread>>;
+    // sub-proxies don't have own threads, sprayed ones are run by the task pool
+    using proxy_entry = std::unique_ptr<baseProxy>;
 
     using mutex_t = std::mutex;
     mutex_t& proxy_lock() const { return proxies_lock_; }
@@ -38,23 +40,27 @@ private:
     vector_type <proxy_entry> proxies_;
     mutable mutex_t proxies_lock_;
 
-    static bool thread_finish(std::unique_ptr<std::thread>& thread_ptr);
+    // persistent threads running sub-proxies, created on first spray. Declared after proxies_, so queued
+    // tasks finish before sub-proxies are destroyed.
+    std::unique_ptr<task_pool> spray_pool_;
+    task_pool& spray_pool();
 public:
     static inline unsigned int subproxy_reserve = 10;
     static inline unsigned int subproxy_thread_spray_min = 2;
+    // spray pool size (0 - number of CPUs) and its queue length; when queue is full, sub-proxy is run in place
+    static inline unsigned int subproxy_pool_threads = 0;
+    static inline std::size_t subproxy_pool_queue = 1024;
 
     explicit MasterProxy(baseCom* c): baseProxy(c) {
         proxies_.reserve(subproxy_reserve);
     }
     vector_type <proxy_entry>& proxies() { return proxies_; };
-    inline void add_proxy(baseProxy* p) { proxies_.emplace_back(p, nullptr); }
-    inline void add_proxy(std::unique_ptr<baseProxy> upx) { proxies_.emplace_back(std::move(upx), nullptr); }
+    inline void add_proxy(baseProxy* p) { proxies_.emplace_back(p); }
+    inline void add_proxy(std::unique_ptr<baseProxy> upx) { proxies_.emplace_back(std::move(upx)); }
 
     int prepare_sockets(baseCom*) override;
 	int handle_sockets_once(baseCom*) override;
 	void shutdown() override;
-    
-    bool run_timers() override;
 
 	std::string hr();
 
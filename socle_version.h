@@ -0,0 +1,8 @@
+#ifndef SOCLE_VERSION_H
+#define SOCLE_VERSION_H
+
+#define SOCLE_GIT_BRANCH "master"
+#define SOCLE_GIT_COMMIT_HASH "2460502"
+#define SOCLE_GIT_VERSION ""
+
+#endif
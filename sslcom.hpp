@@ -452,6 +452,8 @@ public:
     int connect( const char* host, const char* port) override;
 	ssize_t read (int _fd, void* _buf, size_t _n, int _flags ) override;
 	ssize_t write (int _fd, const void* _buf, size_t _n, int _flags ) override;
+	// don't inherit plain socket sendmsg() from L4Proto, data must go through write()
+	ssize_t writev (int _fd, iovec const* _iov, int _iovcnt, int _flags ) override { return baseCom::writev(_fd, _iov, _iovcnt, _flags); }
 	
 	void cleanup() override;
 
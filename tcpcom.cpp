@@ -149,6 +149,7 @@ int TCPCom::bind(unsigned short port) {
         return -129;
 
     so_reuseaddr(sock);
+    if(reuseport_) so_reuseport(sock);
     
     if(nonlocal_dst_) {
         // allows socket to accept connections for non-local IPs
@@ -170,13 +171,16 @@ int TCPCom::bind(unsigned short port) {
         return -130;
     }
     if (listen(sock, config.listen_backlog) == -1)  return -131;
+
+    // accept_batch() drains the backlog until EAGAIN
+    unblock(sock);
     
     return sock;
 }
 
 
 int TCPCom::accept ( int sockfd, sockaddr* addr, socklen_t* addrlen_ ) {
-    int news = ::accept(sockfd, addr, addrlen_);
+    int news = ::accept4(sockfd, addr, addrlen_, GLOBAL_IO_BLOCKING() ? SOCK_CLOEXEC : SOCK_NONBLOCK | SOCK_CLOEXEC);
 
     if (news < 0) {
         if (errno != EAGAIN) {
@@ -193,6 +197,31 @@ int TCPCom::accept ( int sockfd, sockaddr* addr, socklen_t* addrlen_ ) {
     return news;
 }
 
+std::size_t TCPCom::accept_batch(int sockfd, int* out, std::size_t max) {
+
+    int const flags = GLOBAL_IO_BLOCKING() ? SOCK_CLOEXEC : SOCK_NONBLOCK | SOCK_CLOEXEC;
+
+    std::size_t n = 0;
+    while(n < max) {
+        int news = ::accept4(sockfd, nullptr, nullptr, flags);
+
+        if(news < 0) {
+            if(errno == EINTR) continue;
+
+            if(errno != EAGAIN and errno != EWOULDBLOCK) {
+                _err("accept_batch[%d]: failed after %d: %s", sockfd, n, string_error().c_str());
+            }
+            break;
+        }
+
+        on_new_socket(news);
+        out[n++] = news;
+    }
+
+    _dia("accept_batch[%d]: %d accepted", sockfd, n);
+    return n;
+}
+
 bool TCPCom::is_connected(int s) {
 
     // we already **know** connection was established
@@ -58,6 +58,7 @@ public:
     int bind(unsigned short port) override;
     int bind(const char* _path) override { return -1; };
     int accept (int sockfd, sockaddr* addr, socklen_t* addrlen_) override;
+    std::size_t accept_batch(int sockfd, int* out, std::size_t max) override;
     
     ssize_t read(int _fd, void* _buf, size_t _n, int _flags) override { return static_cast<int>(::recv(_fd, _buf, _n, _flags)); };
     ssize_t peek(int _fd, void* _buf, size_t _n, int _flags) override { return read(_fd, _buf, _n, _flags | MSG_PEEK );};
@@ -70,6 +71,19 @@ public:
         }
         return r;
     };
+    ssize_t writev(int _fd, iovec const* _iov, int _iovcnt, int _flags) override {
+        msghdr msg{};
+        msg.msg_iov = const_cast<iovec*>(_iov);
+        msg.msg_iovlen = static_cast<size_t>(_iovcnt);
+
+        auto r = ::sendmsg(_fd, &msg, _flags);
+        if(r < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+        }
+        return r;
+    };
     void shutdown(int _fd) override {
         int r = ::shutdown(_fd, SHUT_RDWR);
         if(r > 0)
@@ -0,0 +1,27 @@
+#ifndef PROXY_PUMP_HPP
+#define PROXY_PUMP_HPP
+
+#include <lrproxy.hpp>
+
+#include <string>
+
+#include <sys/socket.h>
+
+// run proxy until 'want' bytes are read on 'fd', or give up
+inline std::string pump(SimpleLRProxy& p, int fd, std::size_t want) {
+    std::string got;
+    char buf[4096];
+
+    for(int i = 0; i < 500 and got.size() < want; ++i) {
+        p.com()->poll();
+        p.handle_sockets_once(p.com());
+
+        ssize_t n = 0;
+        while((n = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            got.append(buf, static_cast<std::size_t>(n));
+        }
+    }
+    return got;
+}
+
+#endif //PROXY_PUMP_HPP
@@ -0,0 +1,56 @@
+#include <tcpcom.hpp>
+#include <internet.hpp>
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    unsigned short local_port(int s) {
+        sockaddr_storage ss {};
+        socklen_t len = sizeof(ss);
+        ::getsockname(s, reinterpret_cast<sockaddr*>(&ss), &len);
+        return ntohs(inet::to_sockaddr_in(&ss)->sin_port);
+    }
+
+    int connect_to(unsigned short port) {
+        int c = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in sa {};
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if(::connect(c, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0) {
+            ::close(c);
+            return -1;
+        }
+        return c;
+    }
+}
+
+TEST(AcceptBatch, DrainsBacklog) {
+    TCPCom a;
+    auto s = a.bind(static_cast<unsigned short>(0));
+    ASSERT_GT(s, 0);
+    ASSERT_TRUE(::fcntl(s, F_GETFL) & O_NONBLOCK);
+
+    int clients[3];
+    for(auto& c: clients) ASSERT_GE(c = connect_to(local_port(s)), 0);
+
+    int accepted[8];
+    std::size_t n = 0;
+    for(int i = 0; i < 100 and n < 3; ++i) n += a.accept_batch(s, accepted + n, 8 - n);
+    ASSERT_EQ(n, 3);
+
+    for(std::size_t i = 0; i < n; ++i) {
+        ASSERT_TRUE(::fcntl(accepted[i], F_GETFL) & O_NONBLOCK);
+        ASSERT_TRUE(::fcntl(accepted[i], F_GETFD) & FD_CLOEXEC);
+        ::close(accepted[i]);
+    }
+
+    ASSERT_EQ(a.accept_batch(s, accepted, 8), 0);
+
+    for(auto c: clients) ::close(c);
+    ::close(s);
+}
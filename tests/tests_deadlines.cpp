@@ -0,0 +1,69 @@
+#include <baseproxy.hpp>
+#include <uxcom.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    // run proxy loop until 'done' or ~'msec' passes
+    template<typename F>
+    bool run_until(baseProxy& p, long msec, F done) {
+        for(long i = 0; i < msec / baseCom::poll_msec and not done(); ++i) {
+            p.com()->poll();
+            p.run_poll();
+        }
+        return done();
+    }
+}
+
+TEST(ProxyDeadlines, StalledConnectTimesOutWithoutEvents) {
+
+    int r[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, r), 0);
+
+    baseCom::poll_msec = 10;
+
+    baseProxy p(new UxCom());
+    p.pollroot(true);
+
+    // connect which never completes: no data, no events
+    auto* rcx = new baseHostCX(p.com()->slave(), r[1]);
+    rcx->reconnect_delay(1);
+    rcx->opening(true);
+    p.radd(rcx);
+
+    ASSERT_TRUE(run_until(p, 4000, [&] { return rcx->socket() == 0; }));
+    ASSERT_FALSE(p.state().dead());
+
+    p.shutdown();
+    ::close(r[0]);
+}
+
+TEST(ProxyDeadlines, OpenedConnectionIsNotTimedOut) {
+
+    int r[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, r), 0);
+
+    baseCom::poll_msec = 10;
+
+    baseProxy p(new UxCom());
+    p.pollroot(true);
+
+    auto* rcx = new baseHostCX(p.com()->slave(), r[1]);
+    rcx->reconnect_delay(1);
+    rcx->opening(true);
+    p.radd(rcx);
+
+    // first bytes open the connection, connect deadline is replaced by idle one
+    ASSERT_EQ(::send(r[0], "x", 1, 0), 1);
+    ASSERT_TRUE(run_until(p, 1000, [&] { return not rcx->opening(); }));
+
+    run_until(p, 3000, [] { return false; });
+    ASSERT_NE(rcx->socket(), 0);
+    ASSERT_FALSE(p.state().dead());
+
+    p.shutdown();
+    ::close(r[0]);
+}
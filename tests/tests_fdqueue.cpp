@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <poll.h>
+
+#include <fdq.hpp>
+#include <baseproxy.hpp>
+
+#include <gtest/gtest.h>
+
+
+TEST(FdQueueSteal, RequestFollowsLoad) {
+    FdQueue q;
+    q.new_pair(0);
+    q.new_pair(1);
+    q.new_pair(2);
+
+    q.update_load(0, 40);
+    q.update_load(1, 2);
+    q.update_load(2, 10);
+
+    // worker 2 is not light enough compared to worker 0 ... but worker 1 is
+    auto saved_threshold = FdQueue::steal_threshold;
+    FdQueue::steal_threshold = 31;
+    ASSERT_FALSE(q.request_steal(2));
+    ASSERT_TRUE(q.request_steal(1));
+
+    auto req = q.steal_request(0);
+    ASSERT_TRUE(req.has_value());
+    ASSERT_EQ(req->first, 1);
+    ASSERT_EQ(req->second, 16);   // half of difference, capped by steal_batch_max
+
+    // consumed
+    ASSERT_FALSE(q.steal_request(0).has_value());
+
+    FdQueue::steal_threshold = saved_threshold;
+}
+
+TEST(FdQueueSteal, HandOverWakesThief) {
+    FdQueue q;
+    auto pa = q.new_pair(0);
+    q.new_pair(1);
+
+    q.hand_over(0, nullptr);
+    q.hand_over(0, nullptr);
+
+    // two hand-overs, one wakeup
+    uint64_t cnt = 0;
+    ASSERT_EQ(::read(pa.first, &cnt, sizeof(cnt)), sizeof(cnt));
+    ASSERT_EQ(cnt, 1);
+
+    ASSERT_EQ(q.take_over(0).size(), 2);
+    ASSERT_TRUE(q.take_over(0).empty());
+    ASSERT_TRUE(q.take_over(1).empty());
+}
+
+TEST(FdQueuePush, TwoChoicesPicksLighterWorker) {
+    FdQueue q;
+    auto p0 = q.new_pair(0);
+    auto p1 = q.new_pair(1);
+
+    q.update_load(0, 1000);
+    q.update_load(1, 0);
+
+    // worker 1 wins unless both random choices hit worker 0
+    for(int i = 0; i < 64; ++i) ASSERT_EQ(q.push_all(100 + i), 1);
+    ASSERT_GT(q.queued(1), q.queued(0));
+    ASSERT_EQ(q.queued(0) + q.queued(1), 64);
+
+    // each worker gets its own sockets, in order; wakeups are coalesced, one per drained batch
+    int last = 0;
+    for(std::size_t i = 0, n = q.queued(1); i < n; ++i) {
+        auto s = q.pop(1);
+        ASSERT_GT(s, last);
+        last = s;
+    }
+    ASSERT_EQ(q.queued(1), 0);
+
+    // drained queue consumed its wakeup
+    uint64_t cnt = 0;
+    ASSERT_LE(::read(p1.first, &cnt, sizeof(cnt)), 0);
+    (void) p0;
+}
+
+TEST(FdQueuePush, OverflowWhenQueueFull) {
+    auto saved = FdQueue::worker_queue_size;
+    FdQueue::worker_queue_size = 4;
+
+    FdQueue q;
+    q.new_pair(0);
+
+    for(int i = 1; i <= 6; ++i) q.push_all(i);
+    ASSERT_EQ(q.queued(0), 4);
+    ASSERT_EQ(q.overflow_size(), 2);
+
+    std::vector<int> got;
+    for(int i = 0; i < 6; ++i) got.push_back(q.pop(0));
+    std::sort(got.begin(), got.end());
+    ASSERT_EQ(got, std::vector<int>({1, 2, 3, 4, 5, 6}));
+    ASSERT_EQ(q.pop(0), 0);
+
+    FdQueue::worker_queue_size = saved;
+}
+
+TEST(FdQueuePush, NoWorkersGoesToOverflow) {
+    FdQueue q;
+    ASSERT_EQ(q.push_all(7), 0);
+    ASSERT_EQ(q.overflow_size(), 1);
+    ASSERT_EQ(q.pop_if([](int fd) { return fd == 7; }).value_or(0), 7);
+}
+
+TEST(FdQueueWakeup, CoalescedWhileSignalled) {
+    FdQueue q;
+    auto pa = q.new_pair(0);
+    ASSERT_EQ(q.sq_type(), FdQueue::sq_type_t::SQ_EVENTFD);
+
+    for(int i = 1; i <= 10; ++i) q.push_all(i);
+    ASSERT_EQ(q.wakeups(), 1);
+    ASSERT_EQ(q.wakeups_coalesced(), 9);
+
+    // stays readable until the queue is drained
+    for(int i = 1; i <= 9; ++i) {
+        ASSERT_EQ(q.pop(0), i);
+        pollfd p { pa.first, POLLIN, 0 };
+        ASSERT_EQ(::poll(&p, 1, 0), 1);
+    }
+    ASSERT_EQ(q.pop(0), 10);
+
+    pollfd p { pa.first, POLLIN, 0 };
+    ASSERT_EQ(::poll(&p, 1, 0), 0);
+
+    // worker is idle now, next socket signals again
+    q.push_all(11);
+    ASSERT_EQ(q.wakeups(), 2);
+    ASSERT_EQ(::poll(&p, 1, 0), 1);
+}
+
+TEST(FdQueuePush, BatchWakesEachWorkerOnce) {
+    FdQueue q;
+    q.new_pair(0);
+    q.new_pair(1);
+
+    int socks[32];
+    for(int i = 0; i < 32; ++i) socks[i] = 200 + i;
+
+    auto chosen = q.push_batch(socks, 32);
+    ASSERT_EQ(chosen, 2);
+    ASSERT_EQ(q.queued(0) + q.queued(1), 32);
+    ASSERT_EQ(q.wakeups() + q.wakeups_coalesced(), 2);
+}
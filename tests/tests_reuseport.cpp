@@ -0,0 +1,111 @@
+#include <tcpcom.hpp>
+#include <threadedacceptor.hpp>
+#include <internet.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    unsigned short local_port(int s) {
+        sockaddr_storage ss {};
+        socklen_t len = sizeof(ss);
+        ::getsockname(s, reinterpret_cast<sockaddr*>(&ss), &len);
+        return ntohs(inet::to_sockaddr_in(&ss)->sin_port);
+    }
+
+    int connect_to(unsigned short port) {
+        int c = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in sa {};
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if(::connect(c, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0) {
+            ::close(c);
+            return -1;
+        }
+        return c;
+    }
+}
+
+TEST(ReusePort, ListenersShareThePort) {
+    TCPCom a;
+    a.reuseport(true);
+    auto sa = a.bind(static_cast<unsigned short>(0));
+    ASSERT_GT(sa, 0);
+    auto port = local_port(sa);
+
+    TCPCom b;
+    b.reuseport(true);
+    auto sb = b.bind(port);
+    ASSERT_GT(sb, 0);
+    ASSERT_EQ(b.so_reuseport_cpu_steering(sb, { 0, 1 }), 0);
+
+    // without the option port is taken
+    TCPCom c;
+    ASSERT_LT(c.bind(port), 0);
+
+    ::close(sa);
+    ::close(sb);
+}
+
+namespace {
+    using test_acceptor = ThreadedAcceptor<ThreadedAcceptorProxy<baseProxy>>;
+
+    // stop workers and wait for them, their sockets are left for inspection
+    void stop_workers(test_acceptor& acc) {
+        for(auto& [ thr, w ]: acc.tasks()) w->state().dead(true);
+        for(auto& [ thr, w ]: acc.tasks()) {
+            if(thr and thr->joinable()) thr->join();
+        }
+    }
+
+    std::size_t accepted_by_workers(test_acceptor& acc) {
+        std::size_t n = 0;
+        for(auto& [ thr, w ]: acc.tasks()) n += w->ls().size();
+        return n;
+    }
+}
+
+TEST(ReusePort, WorkersTakeOverListeners) {
+    baseCom::poll_msec = 10;
+    auto saved = test_acceptor::reuseport_listeners;
+    test_acceptor::reuseport_listeners = true;
+
+    auto fdq = std::make_shared<FdQueue>();
+    test_acceptor acc(fdq, new TCPCom(), proxyType::proxy());
+    acc.worker_count_preference(2);
+
+    auto s = acc.bind(static_cast<unsigned short>(0), 'L');
+    ASSERT_GT(s, 0);
+    auto port = local_port(s);
+
+    // non-INET listener is not ours to move
+    int ux = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_NE(acc.listen(ux, 'L'), nullptr);
+
+    // waits in acceptor's backlog, must be handed over
+    auto early = connect_to(port);
+    ASSERT_GE(early, 0);
+
+    acc.start_workers();
+
+    ASSERT_EQ(acc.lbs().size(), 1);
+    ASSERT_EQ(acc.lbs()[0]->socket(), ux);
+    ASSERT_EQ(fdq->wakeups() + fdq->wakeups_coalesced(), 1);
+
+    // accepted by worker's own listener
+    auto late = connect_to(port);
+    ASSERT_GE(late, 0);
+
+    for(int i = 0; i < 100 and accepted_by_workers(acc) < 2; ++i) ::usleep(10000);
+    stop_workers(acc);
+
+    ASSERT_EQ(accepted_by_workers(acc), 2);
+    ASSERT_EQ(fdq->wakeups() + fdq->wakeups_coalesced(), 1);
+
+    ::close(early);
+    ::close(late);
+    test_acceptor::reuseport_listeners = saved;
+}
@@ -0,0 +1,150 @@
+#include <lrproxy.hpp>
+#include <uxcom.hpp>
+
+#include "proxy_pump.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST(WriteChain, ForwardsWithoutWritebuf) {
+
+    int l[2], r[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, l), 0);
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, r), 0);
+
+    baseCom::poll_msec = 10;
+
+    SimpleLRProxy p(new UxCom());
+    p.pollroot(true);
+
+    auto* lcx = new baseHostCX(p.com()->slave(), l[1]);
+    auto* rcx = new baseHostCX(p.com()->slave(), r[1]);
+    lcx->write_chain(true);
+    rcx->write_chain(true);
+    p.ladd(lcx);
+    p.radd(rcx);
+
+    std::string up;
+    for(int i = 0; up.size() < 300000; ++i) up += std::to_string(i) + ",";
+
+    std::size_t sent = 0;
+    std::string got;
+    char buf[4096];
+    while(got.size() < up.size()) {
+        if(sent < up.size()) {
+            auto n = ::send(l[0], up.data() + sent, std::min<std::size_t>(16384, up.size() - sent), MSG_DONTWAIT);
+            if(n > 0) sent += static_cast<std::size_t>(n);
+        }
+        p.com()->poll();
+        p.handle_sockets_once(p.com());
+
+        // right writebuf is never used for forwarded data
+        ASSERT_TRUE(rcx->writebuf()->empty());
+
+        ssize_t n = 0;
+        while((n = ::recv(r[0], buf, sizeof(buf), MSG_DONTWAIT)) > 0) got.append(buf, static_cast<std::size_t>(n));
+    }
+    ASSERT_EQ(got, up);
+    ASSERT_EQ(rcx->write_pending(), 0);
+    ASSERT_EQ(rcx->meter_write_bytes, up.size());
+
+    ::close(l[0]);
+    ::close(r[0]);
+}
+
+TEST(WriteChain, KeepsOrderingWithCopiedWrites) {
+
+    int l[2], r[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, l), 0);
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, r), 0);
+
+    baseCom::poll_msec = 10;
+
+    SimpleLRProxy p(new UxCom());
+    p.pollroot(true);
+
+    auto* lcx = new baseHostCX(p.com()->slave(), l[1]);
+    auto* rcx = new baseHostCX(p.com()->slave(), r[1]);
+    rcx->write_chain(true);
+    p.ladd(lcx);
+    p.radd(rcx);
+
+    buffer b(64);
+    b.append("first,", 6);
+    rcx->to_write(b);
+    ASSERT_TRUE(b.empty());
+
+    // chain is not empty: string must queue behind it, not into writebuf
+    rcx->to_write(std::string("second"));
+    ASSERT_TRUE(rcx->writebuf()->empty());
+    ASSERT_EQ(rcx->write_pending(), 12);
+
+    ASSERT_EQ(pump(p, r[0], 12), "first,second");
+
+    ::close(l[0]);
+    ::close(r[0]);
+}
+
+namespace {
+    // send 'up' to left cx of a proxy with two right peers, @return what peers received
+    std::pair<std::string, std::string> fan_out(std::string const& up, bool chain1, bool chain2) {
+
+        int l[2], r1[2], r2[2];
+        EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, l), 0);
+        EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, r1), 0);
+        EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, r2), 0);
+
+        baseCom::poll_msec = 10;
+
+        SimpleLRProxy p(new UxCom());
+        p.pollroot(true);
+
+        auto* lcx = new baseHostCX(p.com()->slave(), l[1]);
+        auto* rcx1 = new baseHostCX(p.com()->slave(), r1[1]);
+        auto* rcx2 = new baseHostCX(p.com()->slave(), r2[1]);
+        rcx1->write_chain(chain1);
+        rcx2->write_chain(chain2);
+        p.ladd(lcx);
+        p.radd(rcx1);
+        p.radd(rcx2);
+
+        EXPECT_EQ(::send(l[0], up.data(), up.size(), 0), static_cast<ssize_t>(up.size()));
+
+        std::string got1, got2;
+        char buf[4096];
+        for(int i = 0; i < 500 and (got1.size() < up.size() or got2.size() < up.size()); ++i) {
+            p.com()->poll();
+            p.handle_sockets_once(p.com());
+
+            ssize_t n = 0;
+            while((n = ::recv(r1[0], buf, sizeof(buf), MSG_DONTWAIT)) > 0) got1.append(buf, static_cast<std::size_t>(n));
+            while((n = ::recv(r2[0], buf, sizeof(buf), MSG_DONTWAIT)) > 0) got2.append(buf, static_cast<std::size_t>(n));
+        }
+
+        ::close(l[0]);
+        ::close(r1[0]);
+        ::close(r2[0]);
+
+        return { got1, got2 };
+    }
+}
+
+TEST(WriteChain, FanOutSharesSlice) {
+
+    // every peer gets full copy of data
+    std::string up(50000, 'm');
+    auto [ got1, got2 ] = fan_out(up, true, true);
+    ASSERT_EQ(got1, up);
+    ASSERT_EQ(got2, up);
+}
+
+TEST(WriteChain, FanOutMixedPeersCopy) {
+
+    // second peer copies into its writebuf, read buffer is not taken over
+    std::string up(50000, 'n');
+    auto [ got1, got2 ] = fan_out(up, true, false);
+    ASSERT_EQ(got1, up);
+    ASSERT_EQ(got2, up);
+}
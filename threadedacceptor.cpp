@@ -27,6 +27,7 @@
 #include <thread>
 
 #include <display.hpp>
+#include <internet.hpp>
 #include <threadedacceptor.hpp>
 #include <log/logger.hpp>
 
@@ -40,6 +41,7 @@ ThreadedAcceptor<Worker>::ThreadedAcceptor (std::shared_ptr<FdQueue> fdq, baseCo
     proxy_type_(t) {
 
     baseProxy::new_raw(true);
+    if(reuseport_listeners) com()->reuseport(true);
 }
 
 template<class Worker>
@@ -59,15 +61,79 @@ void ThreadedAcceptor<Worker>::on_right_new_raw(int s) {
 
 }
 
+template<class Worker>
+void ThreadedAcceptor<Worker>::on_left_new_raw_batch(int const* socks, std::size_t count) {
+	_dia("ThreadedAcceptor::on_left_new_raw_batch: %d connections pushed to the queue", count);
+	hint_push_batch(socks, count);
+}
+
+template<class Worker>
+void ThreadedAcceptor<Worker>::on_right_new_raw_batch(int const* socks, std::size_t count) {
+	_dia("ThreadedAcceptor::on_right_new_raw_batch: %d connections pushed to the queue", count);
+	hint_push_batch(socks, count);
+}
+
 
 
 
 template<class Worker>
-int ThreadedAcceptor<Worker>::run() {
-	
+auto ThreadedAcceptor<Worker>::reusable_listeners() -> std::vector<listener_t> {
+
+    std::vector<listener_t> ret;
+
+    auto collect = [&](auto const& bound, unsigned char side) {
+        for(auto* cx: bound) {
+            sockaddr_storage ss {};
+            socklen_t len = sizeof(ss);
+            if(::getsockname(cx->socket(), reinterpret_cast<sockaddr*>(&ss), &len) != 0) continue;
+
+            unsigned short port = 0;
+            if(ss.ss_family == AF_INET) port = ntohs(inet::to_sockaddr_in(&ss)->sin_port);
+            else if(ss.ss_family == AF_INET6) port = ntohs(inet::to_sockaddr_in6(&ss)->sin6_port);
+            if(port == 0) continue;
+
+            ret.push_back({ cx, port, side });
+        }
+    };
+
+    collect(lbs(), 'l');
+    collect(rbs(), 'r');
+
+    return ret;
+}
+
+template<class Worker>
+void ThreadedAcceptor<Worker>::release_listener(listener_t const& l) {
+
+    // connections already waiting in the backlog are handed over the usual way
+    while(handle_sockets_accept_drain(l.side, com(), l.cx)) {}
+
+    auto& bound = l.side == 'l' ? lbs() : rbs();
+    bound.erase(std::remove(bound.begin(), bound.end(), l.cx), bound.end());
+
+    l.cx->shutdown();
+    drop_cx(l.cx);
+}
+
+template<class Worker>
+void ThreadedAcceptor<Worker>::start_workers() {
+
     pollroot(true);
     hasWorkers<Worker>::create_workers(0, com(), proxy_type());
-	
+
+    std::vector<listener_t> listeners;
+    if(reuseport_listeners) {
+        if(com()->reuseport()) {
+            listeners = reusable_listeners();
+        } else {
+            _err("ThreadedAcceptor::run: acceptor was created before reuseport_listeners was set, not using it");
+        }
+    }
+
+    // worker's socket of each listener, to attach steering program
+    std::vector<int> first_sockets(listeners.size(), -1);
+    bool all_bound = true;
+
 	for( unsigned int i = 0; i < this->tasks().size() ; i++) {
 		auto& thread_worker = this->tasks()[i];
 
@@ -75,11 +141,63 @@ int ThreadedAcceptor<Worker>::run() {
         thread_worker.second->pollroot(true);
         thread_worker.second->parent(this);
 
-		auto* ptr = new std::thread(&Worker::run, thread_worker.second.get());
+        if(not listeners.empty()) {
+            auto& w = thread_worker.second;
+            w->com()->reuseport(true);
+            w->new_raw(true);
+
+            for(std::size_t j = 0; j < listeners.size(); ++j) {
+                auto s = w->bind(listeners[j].port, listeners[j].side);
+                if(s < 0) {
+                    _err("ThreadedAcceptor::run: worker %d cannot listen on port %d", i, listeners[j].port);
+                    all_bound = false;
+                    continue;
+                }
+                if(i == 0) first_sockets[j] = s;
+            }
+        }
+
+		auto* ptr = new std::thread(&hasWorkers<Worker>::run_pinned, thread_worker.second.get(), i);
 		_dia("ThreadedAcceptor::run: started new thread[%d]: ptr=%x, thread_id=%d",i,ptr,ptr->get_id());
         thread_worker.first.reset(ptr);
 	}
+
+    // workers listen now, our sockets can go
+    for(auto const& l: listeners) release_listener(l);
+    _dia("ThreadedAcceptor::run: %d listeners moved to workers", listeners.size());
+
+    if(reuseport_cpu_steering and not listeners.empty()) {
+        auto workers = this->tasks().size();
+        auto worker_of_cpu = cpu_affinity::worker_of_cpu(workers);
+
+        if(not all_bound) {
+            _err("ThreadedAcceptor::run: not all workers listen, cpu steering not used");
+        }
+        else if(worker_of_cpu.empty()) {
+            _err("ThreadedAcceptor::run: workers are not pinned to cpus, cpu steering not used");
+        }
+        else {
+            // steer to the worker pinned on receiving cpu. Closing our socket (slot 0 of the group) moved the last
+            // worker to its slot, worker i is at slot (i + 1) % workers
+            std::vector<int> slot_of_cpu(worker_of_cpu.size(), -1);
+            for(std::size_t c = 0; c < worker_of_cpu.size(); ++c) {
+                if(worker_of_cpu[c] >= 0) slot_of_cpu[c] = static_cast<int>((worker_of_cpu[c] + 1) % workers);
+            }
+
+            for(auto s: first_sockets) {
+                com()->so_reuseport_cpu_steering(s, slot_of_cpu);
+            }
+        }
+    }
+}
+
+template<class Worker>
+int ThreadedAcceptor<Worker>::run() {
 	
+    start_workers();
+
+    // workers are started with caller's affinity, pin only for our loop
+    cpu_affinity::service_scope service;
 	baseProxy::run();
 	
 	return this->tasks().size();
@@ -106,33 +224,119 @@ int ThreadedAcceptorProxy<SubWorker>::handle_sockets_once(baseCom* xcom) {
 
     if (s > 0) {
         _dia("ThreadedAcceptorProxy::run: removed from queue: 0x%016llx (socket %d)", s, s);
+        adopt_socket(s);
+    }
 
-        try {
-            auto cx = std::unique_ptr<baseHostCX>(this->new_cx(s));
-            if (!cx->read_waiting_for_peercom()) {
-                cx->on_accept_socket(s);
-            } else {
-                cx->on_delay_socket(s);
-            }
+    if(work_stealing) {
+        if (auto parent_fd_handler = parent_as_handler.cast(parent()); parent_fd_handler) {
+            steal_adopt(parent_fd_handler);
+        }
+    }
+
+	return MasterProxy::handle_sockets_once(com());
+}
 
-            cx->com()->nonlocal_dst(this->com()->nonlocal_dst());
 
-            if (proxy_type().is_transparent()) {
-                cx->com()->resolve_nonlocal_dst_socket(s);
-            } else
-                if (proxy_type().is_redirect()) {
-                cx->com()->resolve_redirected_dst_socket(s);
-            }
+template<class SubWorker>
+void ThreadedAcceptorProxy<SubWorker>::adopt_socket(int s) {
+
+    try {
+        auto cx = std::unique_ptr<baseHostCX>(this->new_cx(s));
+        if (!cx->read_waiting_for_peercom()) {
+            cx->on_accept_socket(s);
+        } else {
+            cx->on_delay_socket(s);
+        }
 
-            this->on_left_new(cx.release());
+        cx->com()->nonlocal_dst(this->com()->nonlocal_dst());
 
-        } catch (socle::com_error const& e) {
-            _err("cannot handover cx to proxy: %s", e.what());
+        if (proxy_type().is_transparent()) {
+            cx->com()->resolve_nonlocal_dst_socket(s);
+        } else
+            if (proxy_type().is_redirect()) {
+            cx->com()->resolve_redirected_dst_socket(s);
         }
 
+        this->on_left_new(cx.release());
+
+    } catch (socle::com_error const& e) {
+        _err("cannot handover cx to proxy: %s", e.what());
     }
+}
 
-	return MasterProxy::handle_sockets_once(com());
+template<class SubWorker>
+void ThreadedAcceptorProxy<SubWorker>::on_left_new_raw(int s) {
+    _dia("ThreadedAcceptorProxy::on_left_new_raw: accepted socket %d on own listener", s);
+    adopt_socket(s);
+}
+
+template<class SubWorker>
+void ThreadedAcceptorProxy<SubWorker>::on_right_new_raw(int s) {
+    _dia("ThreadedAcceptorProxy::on_right_new_raw: accepted socket %d on own listener", s);
+    adopt_socket(s);
+}
+
+
+template<class SubWorker>
+bool ThreadedAcceptorProxy<SubWorker>::run_timers() {
+
+    bool clicked = MasterProxy::run_timers();
+
+    if(clicked and work_stealing and parent() != nullptr) {
+        if (auto parent_fd_handler = parent_as_handler.cast(parent()); parent_fd_handler) {
+            parent_fd_handler->update_load(worker_id_, proxies().size());
+
+            steal_serve(parent_fd_handler);
+            steal_adopt(parent_fd_handler);
+            parent_fd_handler->request_steal(worker_id_);
+        }
+    }
+
+    return clicked;
+}
+
+template<class SubWorker>
+void ThreadedAcceptorProxy<SubWorker>::steal_serve(FdQueueHandler* handler) {
+
+    auto request = handler->steal_request(worker_id_);
+    if(not request) return;
+
+    auto [ thief, count ] = request.value();
+    uint32_t given = 0;
+
+    auto l_ = std::scoped_lock(proxy_lock());
+
+    // newest sub-proxies first, they are likely the longest to live
+    for(auto i = proxies().size(); i > 0 and given < count; --i) {
+        auto& proxy = proxies()[i - 1];
+
+        if(not proxy or not proxy->migratable()) continue;
+
+        proxy->detach_poller();
+        handler->hand_over(thief, std::move(proxy));
+        proxies().erase(proxies().begin() + static_cast<long>(i - 1));
+        ++given;
+    }
+
+    _dia("ThreadedAcceptorProxy::steal_serve: worker %d handed %d/%d proxies over to worker %d", worker_id_, given,
+         count, thief);
+}
+
+template<class SubWorker>
+void ThreadedAcceptorProxy<SubWorker>::steal_adopt(FdQueueHandler* handler) {
+
+    auto adopted = handler->take_over(worker_id_);
+    if(adopted.empty()) return;
+
+    auto l_ = std::scoped_lock(proxy_lock());
+
+    for(auto& proxy: adopted) {
+        proxy->parent(this);
+        proxy->attach_poller(com());
+        add_proxy(std::move(proxy));
+    }
+
+    _dia("ThreadedAcceptorProxy::steal_adopt: worker %d adopted %d proxies", worker_id_, adopted.size());
 }
 
 
@@ -42,13 +42,34 @@ public:
 	
 	void on_left_new_raw(int) override;
 	void on_right_new_raw(int) override;
+	void on_left_new_raw_batch(int const*, std::size_t) override;
+	void on_right_new_raw_batch(int const*, std::size_t) override;
 	
 	int run() override;
+	// create and start worker threads (done by run())
+	void start_workers();
+
+    // opt-in: each worker listens on its own SO_REUSEPORT socket bound to acceptor's ports and accepts itself.
+    // Acceptor binds with SO_REUSEPORT too (set it before the acceptor is created), its listeners are closed
+    // once all workers listen. No handoff through FdQueue.
+    static inline bool reuseport_listeners = false;
+    // with reuseport_listeners: kernel picks listener of the worker pinned on receiving CPU (needs cpu_affinity policy)
+    static inline bool reuseport_cpu_steering = false;
 
     proxyType proxy_type() const { return proxy_type_; };
 private:
     proxyType proxy_type_;
 
+    struct listener_t {
+        baseHostCX* cx;
+        unsigned short port;
+        unsigned char side;
+    };
+    // bound INET sockets which workers can listen on instead of us
+    std::vector<listener_t> reusable_listeners();
+    // hand over backlog and close listener
+    void release_listener(listener_t const& l);
+
     logan_lite log {"com.tcp.acceptor"};
 };
 
@@ -60,12 +81,28 @@ public:
             MasterProxy(c) {}
 
 	int handle_sockets_once(baseCom*) override;
+    bool run_timers() override;
+
+    // sockets accepted on worker's own listener (ThreadedAcceptor::reuseport_listeners)
+    void on_left_new_raw(int s) override;
+    void on_right_new_raw(int s) override;
+
+    // opt-in: move sub-proxies between workers by their load (see FdQueue::request_steal)
+    static inline bool work_stealing = false;
 
     static std::atomic_int& workers_total() {
         static std::atomic_int workers_total_ = 2;
         return workers_total_;
     };
 private:
+    // create cx for accepted socket and run it
+    void adopt_socket(int s);
+
+    // victim side: release requested number of idle sub-proxies to the thief
+    void steal_serve(FdQueueHandler* handler);
+    // thief side: adopt sub-proxies handed over to us
+    void steal_adopt(FdQueueHandler* handler);
+
     raw::dynamic_cast_cache<baseProxy,FdQueueHandler> parent_as_handler;
     logan_lite log {"com.tcp.worker"};
 };
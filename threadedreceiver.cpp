@@ -34,6 +34,7 @@
 
 #include <linux/in6.h>
 #include <udpcom.hpp>
+#include <mempool/objpool.hpp>
 
 #define USE_SOCKETPAIR
 
@@ -159,7 +160,7 @@ int ThreadedReceiver<Worker>::add_first_datagrams(int sock, SocketInfo& pinfo) {
 
     // lambda creating a new entry
     auto create_new_entry = [](int sock, SocketInfo& pinfo) -> std::shared_ptr<Datagram> {
-        auto entry = std::make_shared<Datagram>();
+        auto entry = mp::make_pooled_shared<Datagram>();
 
         entry->src = pinfo.src.ss.value();
         entry->dst = pinfo.dst.ss.value();
@@ -358,11 +359,13 @@ int ThreadedReceiver<Worker>::run() {
         thread_worker.second->pollroot(true);
         thread_worker.second->parent(this);
 
-        auto* ptr = new std::thread(&Worker::run, thread_worker.second.get());
+        auto* ptr = new std::thread(&hasWorkers<Worker>::run_pinned, thread_worker.second.get(), i);
         _dia("ThreadedReceiver::run: started new thread[%d]: ptr=%x, thread_id=%d",i,ptr,ptr->get_id());
         thread_worker.first.reset(ptr);
     }
     
+    // workers are started with caller's affinity, pin only for our loop
+    cpu_affinity::service_scope service;
     baseProxy::run();
     
     return this->tasks().size();
@@ -20,6 +20,7 @@
 #define THREADEDWORKER_HPP
 
 #include <fdq.hpp>
+#include <cpuaffinity.hpp>
 
 struct proxyType {
     enum class proxy_type_t { NONE, TRANSPARENT, PROXY, REDIRECT } type_;
@@ -88,6 +89,12 @@ public:
 
     constexpr int core_multiplier() const noexcept { return 1; };
 
+    // worker thread entry: place thread by cpu_affinity policy first, so it allocates from its node's memory
+    static void run_pinned(WorkerType* w, std::size_t slot) {
+        cpu_affinity::apply(slot);
+        w->run();
+    }
+
     virtual ~hasWorkers() {
         join_workers();
     };
@@ -115,11 +122,15 @@ public:
 
         logan_lite log("service");
 
-        auto nthreads = std::thread::hardware_concurrency();
+        unsigned int nthreads = 0;
 
         // on default , do the magic as pre-set
         if(count == 0) {
             nthreads = worker_count_preference();
+
+            // no preference: CPUs we are allowed to use (not all of the machine), except one reserved for services
+            if(nthreads == 0) nthreads = static_cast<unsigned int>(cpu_affinity::worker_count());
+
             _dia("create_workers: detected %d cores to use, multiplier to apply: %d.", nthreads, core_multiplier());
             nthreads *= core_multiplier();
         }
@@ -18,6 +18,7 @@
 
 #include <buffer.hpp>
 #include <traflog/threadedpoolwriter.hpp>
+#include <cpuaffinity.hpp>
 
 namespace socle {
     threadedPoolFileWriter::threadedPoolFileWriter() {
@@ -39,6 +40,7 @@ namespace socle {
 
     void threadedPoolFileWriter::worker() {
         :: pthread_setname_np(pthread_self(), "sx-wrt");
+        cpu_affinity::apply_service();
         while(! stop_signal_)
         {
             bool wait = false;
@@ -152,7 +152,7 @@ public:
     std::map<uint64_t,std::shared_ptr<Datagram>> datagrams_received;
   
     // set with all virtual sockets which have data to read
-    epoll::set_type in_virt_set;
+    epoll::virt_set_type in_virt_set;
 };
 
 class UDPCom : public virtual baseCom {
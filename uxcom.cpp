@@ -91,6 +91,9 @@ int UxCom::bind(const char* name) {
         ::close(s);
         return -131;
     }
+
+    // accept_batch() drains the backlog until EAGAIN
+    unblock(s);
     
     return s;
 }